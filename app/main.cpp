@@ -3,14 +3,21 @@
 #include <cmath>
 #include <cstdlib>
 #include <imgui.h>
+#include <optional>
 #include <stdexcept>
 
 #include "imgui-SFML.h"
 
 #include "SFML/System/Clock.hpp"
+#include "SFML/System/Time.hpp"
 #include "SFML/Window/Event.hpp"
 
 #include "block/EditorRenderer.hpp"
+#include "details/Profiler.hpp"
+
+// redraw on demand settings, see EditorRenderer::continuousRedraw
+constexpr int  settleFrames = 3;
+const sf::Time idleTimeout  = sf::milliseconds(250);
 
 int main() {
     try {
@@ -43,33 +50,71 @@ int main() {
         Editor         editor{block};
         EditorRenderer rend{editor, window, font};
 
+        Profiler::get().enabled = true;
         sf::Clock deltaClock;
+        // frames still to draw before going idle, ImGui needs a few to settle after any input
+        int framesPending = settleFrames;
         while (window.isOpen()) {
+            // on demand mode sleeps until there's input, the timeout lets changes made outside of
+            // event handling still be noticed
+            std::optional<sf::Event> maybe_event;
+            if (!rend.continuousRedraw && framesPending == 0) {
+                maybe_event = window.waitEvent(idleTimeout);
+                if (!maybe_event && !rend.hasChanged()) {
+                    PROFILE_SKIP_FRAME(); // idle time isn't frame time
+                    continue;
+                }
+                framesPending = settleFrames;
+            }
 
             sf::Vector2i mousePixPos   = sf::Mouse::getPosition(window);
             sf::Vector2f mouseWorldPos = window.mapPixelToCoords(mousePixPos);
             // sf::Vector2i mousePos      = editor.snapToGrid(mouseWorldPos);
 
-            while (auto maybe_event = window.pollEvent()) {
-                auto& e = *maybe_event;
-                ImGui::SFML::ProcessEvent(window, e);
-                if (ImGui::GetIO().WantCaptureMouse && (e.is<sf::Event::MouseButtonPressed>() ||
-                                                        e.is<sf::Event::MouseButtonReleased>()))
-                    break;
-                if (rend.event(e, mousePixPos)) break;
-                editor.event(e);
-                if (e.is<sf::Event::Closed>()) {
-                    window.close();
+            {
+                PROFILE_SCOPE("events");
+                if (!maybe_event) maybe_event = window.pollEvent();
+                for (; maybe_event; maybe_event = window.pollEvent()) {
+                    framesPending = settleFrames;
+                    auto& e       = *maybe_event;
+                    ImGui::SFML::ProcessEvent(window, e);
+                    if (ImGui::GetIO().WantCaptureMouse &&
+                        (e.is<sf::Event::MouseButtonPressed>() ||
+                         e.is<sf::Event::MouseButtonReleased>()))
+                        break;
+                    if (rend.event(e, mousePixPos)) break;
+                    editor.event(e);
+                    if (e.is<sf::Event::Closed>()) {
+                        window.close();
+                    }
                 }
             }
+            if (framesPending > 0) --framesPending;
 
-            ImGui::SFML::Update(window, deltaClock.restart());
+            {
+                PROFILE_SCOPE("ImGui::SFML::Update");
+                ImGui::SFML::Update(window, deltaClock.restart());
+            }
 
             window.clear();
-            editor.frame(mouseWorldPos); // update state
-            rend.frame(mousePixPos);
-            ImGui::SFML::Render(window);
-            window.display();
+            {
+                PROFILE_SCOPE("editor.frame");
+                editor.frame(mouseWorldPos); // update state
+            }
+            {
+                PROFILE_SCOPE("rend.frame");
+                rend.frame(mousePixPos);
+            }
+            {
+                PROFILE_SCOPE("ImGui::SFML::Render");
+                ImGui::SFML::Render(window);
+            }
+            {
+                PROFILE_SCOPE("display"); // includes waiting on the frame rate limit
+                window.display();
+            }
+            PROFILE_END_FRAME();
+            if (rend.hasChanged()) framesPending = settleFrames; // drawing changed the view
         }
 
         ImGui::SFML::Shutdown();
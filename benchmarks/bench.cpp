@@ -0,0 +1,405 @@
+#include <cmath>
+#include <map>
+#include <random>
+
+#include "benchmark/benchmark.h"
+
+#include "block/Block.hpp"
+#include "details/StableVector.hpp"
+#include "sim/BitParallelSimulator.hpp"
+#include "sim/EventSimulator.hpp"
+#include "sim/KernelCache.hpp"
+#include "sim/LevelSimulator.hpp"
+#include "sim/ParallelSimulator.hpp"
+
+// synthetic designs are sized by connection count, 1k to 1M
+static void connectionCounts(benchmark::internal::Benchmark* bench) {
+    bench->RangeMultiplier(32)->Range(1 << 10, 1 << 20)->Unit(benchmark::kMicrosecond);
+}
+
+// side length of a square lattice with roughly conCount connections
+static int latticeSide(std::int64_t conCount) {
+    return std::max(2, static_cast<int>(std::sqrt(static_cast<double>(conCount) / 2.0)));
+}
+
+// square lattice of unit connections, every inner node is a junction
+static void buildLattice(Block& block, int side) {
+    for (int y = 0; y < side; ++y) {
+        for (int x = 0; x < side; ++x) {
+            block.addConnection({x, y}, {x, y + 1});
+            block.addConnection({x, y}, {x + 1, y});
+        }
+    }
+}
+
+static Block makeLattice(std::int64_t conCount) {
+    Block block{"bench", static_cast<std::size_t>(latticeSide(conCount) + 1)};
+    block.beginBatch();
+    buildLattice(block, latticeSide(conCount));
+    block.commit();
+    return block;
+}
+
+static std::size_t conCount(const Block& block) {
+    std::size_t count = 0;
+    for (const auto& net: block.nets) count += net.obj.getSize();
+    return count;
+}
+
+// Block
+static void BM_addConnection(benchmark::State& state) {
+    int side = latticeSide(state.range(0));
+    for (auto _: state) {
+        Block block{"bench", static_cast<std::size_t>(side + 1)};
+        buildLattice(block, side);
+        benchmark::DoNotOptimize(block.nets.size());
+    }
+    state.SetItemsProcessed(state.iterations() * 2 * side * side);
+}
+BENCHMARK(BM_addConnection)->Apply(connectionCounts);
+
+static void BM_addConnectionBatched(benchmark::State& state) {
+    int side = latticeSide(state.range(0));
+    for (auto _: state) {
+        Block block{"bench", static_cast<std::size_t>(side + 1)};
+        block.beginBatch();
+        buildLattice(block, side);
+        block.commit();
+        benchmark::DoNotOptimize(block.nets.size());
+    }
+    state.SetItemsProcessed(state.iterations() * 2 * side * side);
+}
+BENCHMARK(BM_addConnectionBatched)->Apply(connectionCounts);
+
+// erases a random lattice connection then puts it back so the design stays the same size
+static void BM_eraseCon(benchmark::State& state) {
+    auto                               block = makeLattice(state.range(0));
+    int                                side  = latticeSide(state.range(0));
+    std::mt19937                       gen(42); // NOLINT fixed seed for reproducibility
+    std::uniform_int_distribution<int> coordDist(1, side - 2);
+    for (auto _: state) {
+        Vec2i start{coordDist(gen), coordDist(gen)};
+        Vec2i end = start + Vec2i{1, 0};
+        PortRef      port{std::get<Ref<Node>>(block.whatIsAtCoord(start)),
+                     static_cast<std::size_t>(Direction::right)};
+        block.eraseCon(block.nets[block.getClosNetRef(port).value()].getCon(port));
+        block.addConnection(start, end);
+    }
+    state.counters["connections"] = static_cast<double>(conCount(block));
+}
+BENCHMARK(BM_eraseCon)->Apply(connectionCounts);
+
+// grid of separate short crossing wires, every crossing gets joined
+static void BM_insertOverlap(benchmark::State& state) {
+    int side = std::max(2, static_cast<int>(std::sqrt(static_cast<double>(state.range(0) / 2))));
+    for (auto _: state) {
+        state.PauseTiming();
+        Block block{"bench", static_cast<std::size_t>(side * 3)};
+        block.beginBatch();
+        for (int x = 0; x < side; ++x) {
+            for (int y = 0; y < side; ++y) {
+                block.addConnection({x * 3, y * 3 + 1}, {x * 3 + 2, y * 3 + 1});
+                block.addConnection({x * 3 + 1, y * 3}, {x * 3 + 1, y * 3 + 2});
+            }
+        }
+        block.commit();
+        state.ResumeTiming();
+        for (int x = 0; x < side; ++x) {
+            for (int y = 0; y < side; ++y) {
+                Vec2i pos{x * 3 + 1, y * 3 + 1};
+                auto         cross = std::get<std::pair<Connection, Connection>>(
+                    block.whatIsAtCoord(pos));
+                block.insertOverlap(cross.first, cross.second, pos);
+            }
+        }
+        benchmark::DoNotOptimize(block.nets.size());
+    }
+    state.SetItemsProcessed(state.iterations() * side * side);
+}
+BENCHMARK(BM_insertOverlap)->Apply(connectionCounts);
+
+static void BM_whatIsAtCoord(benchmark::State& state) {
+    auto                               block = makeLattice(state.range(0));
+    std::mt19937                       gen(42); // NOLINT fixed seed for reproducibility
+    std::uniform_int_distribution<int> coordDist(0, latticeSide(state.range(0)));
+    for (auto _: state) {
+        benchmark::DoNotOptimize(block.whatIsAtCoord({coordDist(gen), coordDist(gen)}));
+    }
+    state.counters["connections"] = static_cast<double>(conCount(block));
+}
+BENCHMARK(BM_whatIsAtCoord)->Apply(connectionCounts);
+
+static void BM_getClosNetRef(benchmark::State& state) {
+    auto                   block = makeLattice(state.range(0));
+    std::vector<Ref<Node>> nodeRefs;
+    for (const auto& node: block.nodes) nodeRefs.push_back(node.ind);
+    std::mt19937                               gen(42); // NOLINT fixed seed for reproducibility
+    std::uniform_int_distribution<std::size_t> nodeDist(0, nodeRefs.size() - 1);
+    for (auto _: state) {
+        benchmark::DoNotOptimize(block.getClosNetRef(nodeRefs[nodeDist(gen)]));
+    }
+    state.counters["connections"] = static_cast<double>(conCount(block));
+}
+BENCHMARK(BM_getClosNetRef)->Apply(connectionCounts);
+
+// ClosedNet
+// staircase chain so every connection is kept as a separate corner to corner wire
+static std::vector<Connection> buildStaircase(Block& block, std::int64_t conCount) {
+    std::vector<Connection> cons;
+    Vec2i                   pos{0, 0};
+    block.beginBatch();
+    for (std::int64_t i = 0; i < conCount / 2; ++i) {
+        cons.push_back(block.addConnection(pos, pos + Vec2i{1, 0}));
+        pos += Vec2i{1, 0};
+        cons.push_back(block.addConnection(pos, pos + Vec2i{0, 1}));
+        pos += Vec2i{0, 1};
+    }
+    block.commit();
+    return cons;
+}
+
+static void BM_isConnected(benchmark::State& state) {
+    Block       block{"bench", 1};
+    auto        cons = buildStaircase(block, state.range(0));
+    const auto& net  = block.nets.front().obj;
+    for (auto _: state) {
+        benchmark::DoNotOptimize(net.isConnected(cons.front().portRef1, cons.back().portRef2));
+    }
+}
+BENCHMARK(BM_isConnected)->Apply(connectionCounts);
+
+// splits a chain near one end, cost should follow the smaller side
+static void BM_splitNet(benchmark::State& state) {
+    Block block{"bench", 1};
+    auto  cons    = buildStaircase(block, state.range(0));
+    auto  fullNet = block.nets.front().obj;
+    auto  cutCon  = cons[cons.size() / 10];
+    fullNet.erase(cutCon, {PortType::node, PortType::node});
+    for (auto _: state) {
+        state.PauseTiming();
+        auto net = fullNet;
+        state.ResumeTiming();
+        benchmark::DoNotOptimize(net.splitNet(cutCon.portRef1, cutCon.portRef2));
+    }
+}
+BENCHMARK(BM_splitNet)->Apply(connectionCounts);
+
+// Simulation
+// square grid of 2 input gates, each reading the gate to its left in its own row and the row
+// below, so depth is the side length. The first column reads free nets
+static Block makeGateGrid(std::int64_t gateCount) {
+    int   side = std::max(2, static_cast<int>(std::sqrt(static_cast<double>(gateCount))));
+    Block block{"bench", static_cast<std::size_t>(4 * side)};
+    block.beginBatch();
+    constexpr std::array types{GateType::And, GateType::Or, GateType::Xor};
+    for (int col = 0; col < side; ++col) {
+        for (int row = 0; row < side; ++row) {
+            auto type = types[static_cast<std::size_t>(row + col) % types.size()];
+            block.insertGate(Gate{type, {4 * col + 2, 3 * row}, 2});
+        }
+    }
+    for (int col = 0; col < side; ++col) {
+        for (int row = 0; row < side; ++row) {
+            int x = 4 * col;
+            block.addConnection({col == 0 ? x - 2 : x - 1, 3 * row}, {x + 1, 3 * row});
+        }
+        // branch off the row below once it's wired
+        for (int row = 0; row + 1 < side; ++row) {
+            int x = 4 * col;
+            block.addConnection({x, 3 * row + 3}, {x, 3 * row + 1});
+            block.addConnection({x, 3 * row + 1}, {x + 1, 3 * row + 1});
+        }
+    }
+    block.commit();
+    return block;
+}
+
+static void gateCounts(benchmark::internal::Benchmark* bench) {
+    bench->RangeMultiplier(8)->Range(1 << 10, 1 << 16)->Unit(benchmark::kMicrosecond);
+}
+
+static void BM_compileNetlist(benchmark::State& state) {
+    auto block = makeGateGrid(state.range(0));
+    for (auto _: state) {
+        Netlist netlist{block};
+        benchmark::DoNotOptimize(netlist.gates.data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(block.gates.size()));
+}
+BENCHMARK(BM_compileNetlist)->Apply(gateCounts);
+
+// 16 gate grids chained output to input with a shared second input, each iteration edits the
+// top block so only it recompiles and the grid's kernel is copied in and its ports remapped
+// Items are flattened gates, compare BM_compileNetlist
+static void BM_recompileHierarchy(benchmark::State& state) {
+    constexpr int       instCount = 16;
+    StableVector<Block> library;
+    auto                leaf = library.insert(makeGateGrid(state.range(0) / instCount));
+    auto                top  = library.insert(Block{"top", 100});
+    auto&               grid = library[leaf];
+
+    int   side = static_cast<int>(std::lround(std::sqrt(static_cast<double>(grid.gates.size()))));
+    Vec2i last{4 * side - 1, 3 * (side - 1)}; // output of the last gate
+    grid.addConnection(last, last + Vec2i{2, 0});
+    grid.ports = {{"a", PortType::input, {-2, 0}},
+                  {"b", PortType::input, {-2, 3}},
+                  {"y", PortType::output, last + Vec2i{2, 0}}};
+
+    // instance i has inputs at (4i + 1, 0) and (4i + 1, 1) and its output at (4i + 3, 0)
+    auto& chain = library[top];
+    chain.ports = {{"a", PortType::input, {0, 0}},
+                   {"b", PortType::input, {0, 3}},
+                   {"y", PortType::output, {4 * instCount + 1, 0}}};
+    chain.beginBatch();
+    for (int i = 0; i < instCount; ++i) {
+        int x = 4 * i;
+        chain.insertBlockInst(BlockInst{leaf, grid.ports, {x + 2, 0}});
+        chain.addConnection({i == 0 ? 0 : x - 1, 0}, {x + 1, 0});
+        chain.addConnection({x, 3}, {x, 1});
+        chain.addConnection({x, 1}, {x + 1, 1});
+        if (i + 1 < instCount) chain.addConnection({x, 3}, {x + 4, 3});
+    }
+    chain.addConnection({4 * instCount - 1, 0}, {4 * instCount + 1, 0});
+    chain.commit();
+
+    KernelCache cache{library};
+    int         edit = 0;
+    auto        gate = chain.insertGate(Gate{GateType::Not, {2, 6}, 1});
+    for (auto _: state) {
+        chain.eraseGate(gate); // moved each time so the top block's content is always new
+        gate = chain.insertGate(Gate{GateType::Not, {2, 6 + 3 * ++edit}, 1});
+        benchmark::DoNotOptimize(cache.get(top).gates.data());
+    }
+    state.SetItemsProcessed(state.iterations() *
+                            static_cast<std::int64_t>(cache.get(top).gates.size()));
+    state.counters["compiles"] = static_cast<double>(cache.getCompileCount());
+}
+BENCHMARK(BM_recompileHierarchy)->Apply(gateCounts);
+
+// items are gate evaluations
+static void BM_levelSimulate(benchmark::State& state) {
+    auto           block = makeGateGrid(state.range(0));
+    Netlist        netlist{block};
+    LevelSimulator sim{netlist};
+    bool           value = false;
+    for (auto _: state) {
+        for (auto net: netlist.freeNets) sim.set(net, value = !value);
+        sim.evaluate();
+        benchmark::DoNotOptimize(sim.get(netOf(netlist.gates.back().output)));
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(netlist.gates.size()));
+}
+BENCHMARK(BM_levelSimulate)->Apply(gateCounts);
+
+// items are gate evaluations times patterns, comparable with BM_levelSimulate
+template <typename Word>
+static void BM_bitParallelSimulate(benchmark::State& state) {
+    auto                       block = makeGateGrid(state.range(0));
+    Netlist                    netlist{block};
+    BitParallelSimulator<Word> sim{netlist};
+    std::mt19937_64            gen(42); // NOLINT fixed seed for reproducibility
+    for (auto _: state) {
+        for (auto net: netlist.freeNets) {
+            Word patterns;
+            for (auto& word: patterns.words) word = gen();
+            sim.set(net, patterns);
+        }
+        sim.evaluate();
+        benchmark::DoNotOptimize(sim.get(netOf(netlist.gates.back().output)));
+    }
+    state.SetItemsProcessed(state.iterations() *
+                            static_cast<std::int64_t>(netlist.gates.size() * Word::patternCount));
+}
+BENCHMARK_TEMPLATE(BM_bitParallelSimulate, PatternWord<1>)->Apply(gateCounts);
+BENCHMARK_TEMPLATE(BM_bitParallelSimulate, PatternWord<4>)->Apply(gateCounts);
+BENCHMARK_TEMPLATE(BM_bitParallelSimulate, PatternWord<8>)->Apply(gateCounts);
+
+// scaling from 1 thread to every core, the grid's levels are as wide as its side
+static void BM_parallelSimulate(benchmark::State& state) {
+    static std::map<std::int64_t, Netlist> netlists; // grid builds are slow, share them
+
+    auto              gateCount = state.range(0);
+    const auto&       netlist   =
+        netlists.try_emplace(gateCount, makeGateGrid(gateCount)).first->second;
+    WorkStealingPool  pool{static_cast<std::size_t>(state.range(1))};
+    ParallelSimulator sim{netlist, pool, 64};
+    bool              value = false;
+    for (auto _: state) {
+        for (auto net: netlist.freeNets) sim.set(net, value = !value);
+        sim.evaluate();
+        benchmark::DoNotOptimize(sim.get(netOf(netlist.gates.back().output)));
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(netlist.gates.size()));
+}
+static void threadCounts(benchmark::internal::Benchmark* bench) {
+    auto cores = std::max(1U, std::thread::hardware_concurrency());
+    bench->ArgsProduct({{1 << 16, 1 << 18}, benchmark::CreateDenseRange(1, cores, 1)});
+}
+BENCHMARK(BM_parallelSimulate)
+    ->Apply(threadCounts)
+    ->ArgNames({"gates", "threads"})
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+
+// toggles one input of column 0 and runs until settled, items are gates evaluated
+// the top row's input only reaches the top row, the bottom row's fans out across the whole grid
+static void BM_eventSimulateToggle(benchmark::State& state) {
+    auto           block = makeGateGrid(state.range(0));
+    Netlist        netlist{block};
+    EventSimulator sim{netlist};
+    sim.settle(std::numeric_limits<std::uint64_t>::max());
+    auto input = netlist.freeNets[state.range(1) == 0 ? 0 : netlist.freeNets.size() - 1];
+    auto startEvaluations = sim.getEvaluationCount();
+    bool value            = false;
+    for (auto _: state) {
+        sim.set(input, value = !value);
+        sim.settle(std::numeric_limits<std::uint64_t>::max());
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(sim.getEvaluationCount() - startEvaluations));
+    state.counters["gatesPerToggle"] = benchmark::Counter(
+        static_cast<double>(sim.getEvaluationCount() - startEvaluations) /
+        static_cast<double>(state.iterations()));
+}
+BENCHMARK(BM_eventSimulateToggle)
+    ->ArgsProduct({benchmark::CreateRange(1 << 10, 1 << 16, 8), {0, 1}})
+    ->ArgNames({"gates", "bottom"})
+    ->Unit(benchmark::kMicrosecond);
+
+// StableVector
+static void BM_StableVectorInsert(benchmark::State& state) {
+    for (auto _: state) {
+        StableVector<int> vec;
+        for (int i = 0; i < state.range(0); ++i) vec.insert(i);
+        benchmark::DoNotOptimize(vec.size());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StableVectorInsert)->Apply(connectionCounts);
+
+static void BM_StableVectorErase(benchmark::State& state) {
+    for (auto _: state) {
+        state.PauseTiming();
+        StableVector<int>     vec;
+        std::vector<Ref<int>> refs;
+        for (int i = 0; i < state.range(0); ++i) refs.push_back(vec.insert(i));
+        std::mt19937 gen(42); // NOLINT fixed seed for reproducibility
+        std::shuffle(refs.begin(), refs.end(), gen);
+        state.ResumeTiming();
+        for (const auto& ref: refs) vec.erase(ref);
+        benchmark::DoNotOptimize(vec.size());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StableVectorErase)->Apply(connectionCounts);
+
+static void BM_StableVectorIterate(benchmark::State& state) {
+    StableVector<int> vec;
+    for (int i = 0; i < state.range(0); ++i) vec.insert(i);
+    for (auto _: state) {
+        long long sum = 0;
+        for (const auto& elem: vec) sum += elem.obj;
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StableVectorIterate)->Apply(connectionCounts);
@@ -1,42 +1,230 @@
 #include "Block.hpp"
 
 // Block
-bool Block::collisionCheck(const Connection& con, const sf::Vector2i& coord) const {
+bool Block::collisionCheck(const Connection& con, const Vec2i& coord) const {
     return isVecBetween(coord, getPort(con.portRef1).portPos, getPort(con.portRef2).portPos);
 }
 
+void Block::touchNode(const Vec2i& pos) {
+    nodeEdits.emplace_back(generation, pos);
+    if (nodeEdits.size() > nodeEditLogSize) {
+        droppedNodeEdits = nodeEdits.front().first;
+        nodeEdits.pop_front();
+    }
+}
+
+std::optional<std::vector<Vec2i>> Block::getNodeEditsSince(std::uint64_t since) const {
+    if (since < droppedNodeEdits) return {};
+    std::vector<Vec2i> positions;
+    for (auto it = nodeEdits.rbegin(); it != nodeEdits.rend() && it->first > since; ++it) {
+        positions.push_back(it->second);
+    }
+    return positions;
+}
+
+Ref<Node> Block::insertNode(const Vec2i& pos) {
+    auto node = nodes.insert(Node{pos});
+    occupancy.insertNode(pos, node);
+    ++generation;
+    touchNode(pos);
+    return node;
+}
+
+void Block::eraseNode(Ref<Node> node) {
+    auto pos = nodes[node].pos;
+    occupancy.eraseNode(pos);
+    nodes.erase(node);
+    ++generation;
+    touchNode(pos);
+}
+
+bool Block::isFootprintFree(const Vec2i& pos, const std::vector<PortInst>& objPorts) const {
+    auto isFree = [&](const Vec2i& coord) {
+        return typeOf(whatIsAtCoord(coord)) == ObjAtCoordType::Empty;
+    };
+    return isFree(pos) && std::ranges::all_of(objPorts, isFree, &PortInst::portPos);
+}
+
+void Block::erasePortCons(const PortObjRef& obj, std::size_t portCount) {
+    for (std::size_t portNum = 0; portNum < portCount; ++portNum) {
+        PortRef port{obj, portNum};
+        if (auto netRef = getClosNetRef(port)) eraseCon(nets[netRef.value()].getCon(port));
+    }
+}
+
+Ref<Gate> Block::insertGate(Gate gate) {
+    if (!isFootprintFree(gate.pos, gate.ports))
+        throw std::logic_error("Tried to place gate on top of something else");
+    auto gateRef = gates.insert(std::move(gate));
+    occupancy.insertPortObj(gateRef, gates[gateRef]);
+    ++generation;
+    return gateRef;
+}
+
+void Block::eraseGate(Ref<Gate> gate) {
+    erasePortCons(gate, gates[gate].ports.size());
+    occupancy.erasePortObj(gates[gate]);
+    gates.erase(gate);
+    ++generation;
+}
+
+Ref<BlockInst> Block::insertBlockInst(BlockInst inst) {
+    if (!isFootprintFree(inst.pos, inst.ports))
+        throw std::logic_error("Tried to place block instance on top of something else");
+    auto instRef = blockInstances.insert(std::move(inst));
+    occupancy.insertPortObj(instRef, blockInstances[instRef]);
+    ++generation;
+    return instRef;
+}
+
+void Block::eraseBlockInst(Ref<BlockInst> inst) {
+    erasePortCons(inst, blockInstances[inst].ports.size());
+    occupancy.erasePortObj(blockInstances[inst]);
+    blockInstances.erase(inst);
+    ++generation;
+}
+
+// a node's connection count decides whether it's drawn as a junction
+void Block::touchConNodes(const Connection& con) {
+    for (const auto& port: {con.portRef1, con.portRef2}) {
+        if (typeOf(port) == PortObjType::Node) touchNode(getPort(port).portPos);
+    }
+}
+
+void Block::insertNetCon(Ref<ClosedNet> netRef, const Connection& con) {
+    nets[netRef].insert(con, getPortType(con));
+    portNets.insert_or_assign(con.portRef1, netRef);
+    portNets.insert_or_assign(con.portRef2, netRef);
+    occupancy.insertCon(con, getPort(con.portRef1).portPos, getPort(con.portRef2).portPos);
+    touchNet(netRef);
+    touchConNodes(con);
+}
+
+void Block::eraseNetCon(Ref<ClosedNet> netRef, const Connection& con) {
+    nets[netRef].erase(con, getPortType(con));
+    portNets.erase(con.portRef1);
+    portNets.erase(con.portRef2);
+    occupancy.eraseCon(getPort(con.portRef1).portPos, getPort(con.portRef2).portPos);
+    touchNet(netRef);
+    touchConNodes(con);
+}
+
+Ref<ClosedNet> Block::insertNet(ClosedNet&& net) {
+    auto netRef = nets.insert(std::move(net));
+    for (const auto& con: nets[netRef]) {
+        portNets.insert_or_assign(con.portRef1, netRef);
+        portNets.insert_or_assign(con.portRef2, netRef);
+    }
+    touchNet(netRef);
+    return netRef;
+}
+
+void Block::eraseNet(Ref<ClosedNet> netRef) {
+    nets.erase(netRef);
+    netGenerations.erase(netRef);
+    ++generation;
+}
+
+// Moves the smaller net into the bigger one and returns the surviving net
+Ref<ClosedNet> Block::mergeNets(Ref<ClosedNet> net1Ref, Ref<ClosedNet> net2Ref) {
+    if (nets[net1Ref].getSize() < nets[net2Ref].getSize()) std::swap(net1Ref, net2Ref);
+    // net1 is now the bigger of the two, += throws before anything changes if both have inputs
+    nets[net1Ref] += nets[net2Ref];
+    for (const auto& con: nets[net2Ref]) {
+        portNets.insert_or_assign(con.portRef1, net1Ref);
+        portNets.insert_or_assign(con.portRef2, net1Ref);
+    }
+    eraseNet(net2Ref);
+    touchNet(net1Ref);
+    return net1Ref;
+}
+
+// Returns the net at the root of the batch union-find tree containing net, compressing the path
+Ref<ClosedNet> Block::findBatchRoot(Ref<ClosedNet> net) {
+    auto root = net;
+    for (auto it = batchNetParents.find(root); it != batchNetParents.end() && it->second != root;
+         it     = batchNetParents.find(root)) {
+        root = it->second;
+    }
+    while (net != root) {
+        auto& parent = batchNetParents.find(net)->second;
+        net          = parent;
+        parent       = root;
+    }
+    return root;
+}
+
+Ref<ClosedNet> Block::joinNets(Ref<ClosedNet> net1Ref, Ref<ClosedNet> net2Ref) {
+    if (!batching) return mergeNets(net1Ref, net2Ref);
+    batchNetParents.try_emplace(net1Ref, net1Ref);
+    batchNetParents.try_emplace(net2Ref, net2Ref);
+    auto root1 = findBatchRoot(net1Ref);
+    auto root2 = findBatchRoot(net2Ref);
+    if (root1 != root2) batchNetParents.insert_or_assign(root2, root1);
+    return net1Ref;
+}
+
+// Throws if a connection can't leave pos in portDir, without changing anything
+void Block::checkNewPort(const Vec2i& pos, Direction portDir) const {
+    ObjAtCoord var = whatIsAtCoord(pos);
+    switch (typeOf(var)) {
+    case ObjAtCoordType::Empty:
+    case ObjAtCoordType::Con:
+        return;
+    case ObjAtCoordType::Port: { // gate and block instance ports only connect the way they face
+        auto port = std::get<PortRef>(var);
+        if (contains(port)) throw std::logic_error("checkNewPort... port already connected");
+        if (getPort(port).portDir != portDir)
+            throw std::logic_error("checkNewPort... port faces the other way");
+        return;
+    }
+    case ObjAtCoordType::Node:
+        if (contains(PortRef{std::get<Ref<Node>>(var), static_cast<std::size_t>(portDir)}))
+            throw std::logic_error("checkNewPort... port direction already connected");
+        return;
+    default:
+        throw std::logic_error("Cannot make connection to location which isn't viable");
+    }
+}
+
 // Returns ref to port at location
 // If there isn't one creates one according to what's currently there;
 // should only really be used when making a new connection
-[[nodiscard]] PortRef Block::makeNewPortRef(const sf::Vector2i& pos, Direction portDir) {
+[[nodiscard]] PortRef Block::makeNewPortRef(const Vec2i& pos, Direction portDir) {
+    checkNewPort(pos, portDir);
+    return makePortRef(pos, portDir);
+}
+
+// makeNewPortRef without the check, for callers that have already done it
+[[nodiscard]] PortRef Block::makePortRef(const Vec2i& pos, Direction portDir) {
     ObjAtCoord var = whatIsAtCoord(pos);
     switch (typeOf(var)) {
     case ObjAtCoordType::Empty: { // make new node
-        Ref<Node> node = nodes.insert(Node{pos});
+        Ref<Node> node = insertNode(pos);
         return {node, static_cast<std::size_t>(portDir)};
     }
     case ObjAtCoordType::Con: { // make new node and split connection
-        auto node   = nodes.insert(Node{pos});
+        auto node   = insertNode(pos);
         auto oldCon = std::get<Connection>(var);
         splitCon(oldCon, node);
         return {node, static_cast<std::size_t>(portDir)};
     }
-    case ObjAtCoordType::Port: { // return port
+    case ObjAtCoordType::Port: // return port
         return std::get<PortRef>(var);
-    }
     case ObjAtCoordType::Node: { // if redundant delete node else return port
         Ref<Node> node = std::get<Ref<Node>>(var);
         PortRef   newPort{node, static_cast<std::size_t>(portDir)};
-        if (contains(newPort))
-            throw std::logic_error("makeNewPortRef... port direction already connected");
+        if (batching) { // redundancy dealt with on commit
+            batchNodes.insert(node);
+            return newPort;
+        }
         PortRef redundantPort{node, static_cast<std::size_t>(reverseDir(portDir))};
         auto    redundantPortNet = getClosNetRef(redundantPort);
         if (redundantPortNet && getNodeConCount(node) == 1) { // if node is redundant
-            auto& net          = nets[redundantPortNet.value()];
-            auto  redundantCon = net.getCon(redundantPort);
-            net.erase(redundantCon, getPortType(redundantCon));
-            nodes.erase(node);
-            if (net.getSize() == 0) nets.erase(redundantPortNet.value());
+            auto redundantCon = nets[redundantPortNet.value()].getCon(redundantPort);
+            eraseNetCon(redundantPortNet.value(), redundantCon);
+            eraseNode(node);
+            if (nets[redundantPortNet.value()].getSize() == 0) eraseNet(redundantPortNet.value());
             return redundantCon.portRef2;
         }
         return newPort;
@@ -52,56 +240,52 @@ void Block::insertCon(const Connection& con) {
 
     std::optional<Ref<ClosedNet>> net1{};
     if (typeOf(con.portRef1) == PortObjType::Node) {
-        net1 = getClosNetRef(std::get<Ref<Node>>(con.portRef1.ref));
+        net1 = getClosNetRef(std::get<Ref<Node>>(con.portRef1.ref()));
     }
     std::optional<Ref<ClosedNet>> net2{};
     if (typeOf(con.portRef2) == PortObjType::Node) {
-        net2 = getClosNetRef(std::get<Ref<Node>>(con.portRef2.ref));
+        net2 = getClosNetRef(std::get<Ref<Node>>(con.portRef2.ref()));
     }
-    auto portTypes = getPortType(con);
     if (!net1 && !net2) { // make new closed network
         auto netRef = nets.insert(ClosedNet{});
-        nets[netRef].insert(con, portTypes);
+        insertNetCon(netRef, con);
         return;
     }
     if (net1 && net2) { // connecting two existing networks
         auto net1Ref = net1.value();
         auto net2Ref = net2.value();
         if (net1Ref == net2Ref) { // making loop within closed network
-            nets[net1Ref].insert(con, portTypes);
+            insertNetCon(net1Ref, con);
             return;
         } else { // connecting two closed networks
-            if (nets[net1Ref].getSize() < nets[net2Ref].getSize()) std::swap(net1Ref, net2Ref);
-            // net1 is now the bigger of the two
-            nets[net1Ref] += nets[net2Ref];
-            nets.erase(net2Ref);
-            nets[net1Ref].insert(con, portTypes);
+            insertNetCon(joinNets(net1Ref, net2Ref), con);
             return;
         }
     }
     // extending network
-    nets[net1 ? net1.value() : net2.value()].insert(con, portTypes);
+    insertNetCon(net1 ? net1.value() : net2.value(), con);
     return;
 }
 
 void Block::splitCon(const Connection& oldCon, Ref<Node> nodeRef) {
     assert(contains(oldCon));
     assert(collisionCheck(oldCon, nodes[nodeRef].pos));
-    auto& net = nets[getClosNetRef(oldCon).value()];
-    net.erase(oldCon, getPortType(oldCon));
+    auto netRef = getClosNetRef(oldCon).value();
+    eraseNetCon(netRef, oldCon);
     auto dir = getPort(oldCon.portRef1).portDir;
     auto con =
         Connection(oldCon.portRef1, PortRef{nodeRef, static_cast<std::size_t>(reverseDir(dir))});
-    net.insert(con, getPortType(con));
+    insertNetCon(netRef, con);
     con = Connection(oldCon.portRef2, PortRef{nodeRef, static_cast<std::size_t>(dir)});
-    net.insert(con, getPortType(con));
+    insertNetCon(netRef, con);
 }
 
 void Block::updateNode(Ref<Node> node) {
     if (getNodeConCount(node) == 0) {
-        nodes.erase(node);
+        eraseNode(node);
     } else if (getNodeConCount(node) == 2) {
-        auto&                     net = nets[getClosNetRef(node).value()];
+        auto                      netRef = getClosNetRef(node).value();
+        auto&                     net    = nets[netRef];
         std::optional<Connection> con1;
         PortRef                   upPort{node, static_cast<std::size_t>(Direction::up)};
         PortRef                   leftPort{node, static_cast<std::size_t>(Direction::left)};
@@ -117,13 +301,11 @@ void Block::updateNode(Ref<Node> node) {
         PortRef oppPort{node, static_cast<std::size_t>(oppDir)};
         if (!net.contains(oppPort)) return;
         Connection con2 = net.getCon(oppPort);
-        // port types don't matter cause gonna readd anyway
-        auto emptyPortType = std::make_pair(PortType::node, PortType::node);
-        net.erase(con1.value(), emptyPortType);
-        net.erase(con2, emptyPortType);
-        nodes.erase(node);
+        eraseNetCon(netRef, con1.value());
+        eraseNetCon(netRef, con2);
+        eraseNode(node);
         Connection newCon{con1->portRef2, con2.portRef2};
-        net.insert(newCon, emptyPortType);
+        insertNetCon(netRef, newCon);
     }
 }
 
@@ -139,112 +321,158 @@ void Block::updateNode(Ref<Node> node) {
 //     throw std::logic_error("Port type not handled in getPort");
 // }
 
-const PortInst& Block::getPort(const PortRef& port) const {
-    switch (typeOf(port.ref)) {
+PortInst Block::getPort(const PortRef& port) const {
+    switch (typeOf(port)) {
     case PortObjType::Node:
-        return nodes[std::get<Ref<Node>>(port.ref)].ports[port.portNum];
+        return nodes[std::get<Ref<Node>>(port.ref())].getPort(port.portNum());
     case PortObjType::Gate:
-        return gates[std::get<Ref<Gate>>(port.ref)].ports[port.portNum];
+        return gates[std::get<Ref<Gate>>(port.ref())].ports[port.portNum()];
     case PortObjType::BlockInst:
-        return blockInstances[std::get<Ref<BlockInst>>(port.ref)].ports[port.portNum];
+        return blockInstances[std::get<Ref<BlockInst>>(port.ref())].ports[port.portNum()];
     }
     throw std::logic_error("Port type not handled in getPort");
 }
 
 PortType Block::getPortType(const PortRef& port) const {
-    switch (typeOf(port.ref)) {
+    switch (typeOf(port)) {
     case PortObjType::Node:
         return PortType::node;
     case PortObjType::Gate:
-        throw std::runtime_error("Block::getPortType not implemented for Gate yet");
-    case PortObjType::BlockInst:
-        throw std::runtime_error("Block::getPortType not implemented for BlockInst yet");
+    case PortObjType::BlockInst: { // an object's output is its net's input and vice versa
+        auto type = getPort(port).portType;
+        if (type == PortType::node) return type;
+        return type == PortType::input ? PortType::output : PortType::input;
+    }
     }
     throw std::logic_error("Port type not handled in getPortType");
 }
 
 std::pair<PortType, PortType> Block::getPortType(const Connection& con) const {
-    return std::make_pair(getPortType(con.portRef1), getPortType(con.portRef1));
+    return std::make_pair(getPortType(con.portRef1), getPortType(con.portRef2));
 }
 
-ObjAtCoord Block::whatIsAtCoord(const sf::Vector2i& coord) const {
-    // check for nodes
-    for (const auto& node: nodes) {
-        if (coord == node.obj.pos) return node.ind;
-    }
+ObjAtCoord Block::whatIsAtCoord(const Vec2i& coord) const {
+    const auto* cell = occupancy.find(coord);
+    if (!cell) return {};
+    // nodes and gates take precedence
+    if (cell->node) return cell->node.value();
+    if (cell->port) return cell->port.value();
+    if (cell->gate) return cell->gate.value();
+    if (cell->blockInst) return cell->blockInst.value();
     // check connections
-    std::vector<Connection> cons;
-    for (const auto& net: nets) {
-        for (const auto& con: net.obj) {
-            if (collisionCheck(con, coord)) cons.push_back(con);
-        }
-    }
-    if (cons.size() > 2)
-        throw std::logic_error("Should never be more than 2 connections overlapping");
-    else if (cons.size() == 2) {
-        return std::make_pair(cons[0], cons[1]);
-    } else if (cons.size() == 1) {
-        return cons[0];
-    }
+    if (cell->hori && cell->vert) return std::make_pair(cell->hori.value(), cell->vert.value());
+    if (cell->hori) return cell->hori.value();
+    if (cell->vert) return cell->vert.value();
     return {};
 }
 
+std::vector<Ref<Node>> Block::nodesBetween(const Vec2i& end1, const Vec2i& end2) const {
+    std::vector<Ref<Node>> found;
+    occupancy.forEachNodeBetween(end1, end2, [&](Ref<Node> node) { found.push_back(node); });
+    return found;
+}
+
+std::vector<Connection> Block::consAlong(const Vec2i& end1, const Vec2i& end2) const {
+    std::vector<Connection> found;
+    occupancy.forEachConAlong(end1, end2, [&](const Connection& con) { found.push_back(con); });
+    return found;
+}
+
 [[nodiscard]] std::size_t Block::getNodeConCount(const Ref<Node>& node) const {
-    auto ref = getClosNetRef(node);
-    if (!ref) return 0;
-    const auto& net   = nets[ref.value()]; // connection assumed because node
     std::size_t count = 0;
     for (std::size_t port = 0; port < 4; ++port) {
-        if (net.contains(PortRef{node, port})) ++count;
+        if (portNets.contains(PortRef{node, port})) ++count;
     }
     return count;
 }
 
-Connection Block::addConnection(const sf::Vector2i& startPos, const sf::Vector2i& endPos) {
-    PortRef    startPort = makeNewPortRef(startPos, vecToDir(endPos - startPos));
-    PortRef    endPort   = makeNewPortRef(endPos, vecToDir(startPos - endPos));
+Connection Block::addConnection(const Vec2i& startPos, const Vec2i& endPos) {
+    auto startDir = vecToDir(endPos - startPos);
+    auto endDir   = vecToDir(startPos - endPos);
+    // both ends are checked before either is made so a bad end can't leave a stray node behind
+    checkNewPort(startPos, startDir);
+    checkNewPort(endPos, endDir);
+    PortRef    startPort = makePortRef(startPos, startDir);
+    PortRef    endPort   = makePortRef(endPos, endDir);
     Connection con{startPort, endPort};
     insertCon(con);
     return con;
 }
 
-void Block::insertOverlap(const Connection& con1, const Connection& con2, const sf::Vector2i& pos) {
-    auto node    = nodes.insert(Node(pos));
+void Block::insertOverlap(const Connection& con1, const Connection& con2, const Vec2i& pos) {
+    auto node    = insertNode(pos);
     auto con1Net = getClosNetRef(con1).value();
     auto con2Net = getClosNetRef(con2).value();
     splitCon(con1, node);
     if (con1Net != con2Net) {
         // join nets
-        // code copied from insertCon
-        // can't just call it because erasing of con2 could make nodes float
-        if (nets[con1Net].getSize() < nets[con2Net].getSize()) std::swap(con1Net, con2Net);
-        nets[con1Net] += nets[con2Net];
-        nets.erase(con2Net);
+        // can't just call insertCon because erasing of con2 could make nodes float
+        joinNets(con1Net, con2Net);
     }
     splitCon(con2, node);
 }
 
 void Block::eraseCon(const Connection& con) {
+    if (batching) throw std::logic_error("eraseCon not supported while batching. Commit first");
     auto netRef = getClosNetRef(con);
     if (!netRef.has_value()) throw std::logic_error("tried to delete non existant con");
+    eraseNetCon(netRef.value(), con);
     auto& net = nets[netRef.value()];
-    net.erase(con, getPortType(con));
-    if (!net.isConnected(con.portRef1, con.portRef2)) { // network split
-        auto newNet = net.splitNet(con.portRef1);
+    if (auto newNet = net.splitNet(con.portRef1, con.portRef2)) { // network split
         if (net.getSize() == 0) { // delete old net if empty
-            nets.erase(netRef.value());
+            eraseNet(netRef.value());
+        } else {
+            touchNet(netRef.value());
         }
-        if (newNet.getSize() != 0) { // add new net if not empty
-            nets.insert(newNet);
+        if (newNet->getSize() != 0) { // add new net if not empty
+            insertNet(std::move(newNet.value()));
         }
     }
     // delete now disconnected nodes
     if (typeOf(con.portRef1) == PortObjType::Node) {
-        auto node = std::get<Ref<Node>>(con.portRef1.ref);
+        auto node = std::get<Ref<Node>>(con.portRef1.ref());
         updateNode(node);
     }
     if (typeOf(con.portRef2) == PortObjType::Node) {
-        auto node = std::get<Ref<Node>>(con.portRef2.ref);
+        auto node = std::get<Ref<Node>>(con.portRef2.ref());
         updateNode(node);
     }
-}
\ No newline at end of file
+}
+
+void Block::beginBatch() {
+    if (batching) throw std::logic_error("beginBatch called while already batching");
+    batching = true;
+}
+
+void Block::commit() {
+    if (!batching) throw std::logic_error("commit called without beginBatch");
+
+    // merge each group of joined nets into its biggest member, moving every con at most once
+    std::vector<Ref<ClosedNet>> joinedNets;
+    joinedNets.reserve(batchNetParents.size());
+    for (const auto& [net, parent]: batchNetParents) joinedNets.push_back(net);
+    absl::flat_hash_map<Ref<ClosedNet>, std::vector<Ref<ClosedNet>>> groups;
+    for (auto net: joinedNets) groups[findBatchRoot(net)].push_back(net);
+    // groups that would join two drivers are left unjoined, everything else is committed so the
+    // batch state can be cleared either way
+    auto conflicts = absl::erase_if(groups, [&](const auto& group) {
+        return std::ranges::count_if(group.second,
+                                     [&](auto net) { return nets[net].hasInput(); }) > 1;
+    });
+    batching = false;
+    for (const auto& [root, members]: groups) {
+        auto biggest = *std::max_element(members.begin(), members.end(), [&](auto a, auto b) {
+            return nets[a].getSize() < nets[b].getSize();
+        });
+        for (auto member: members) {
+            if (member != biggest) biggest = mergeNets(biggest, member);
+        }
+    }
+    batchNetParents.clear();
+
+    for (auto node: batchNodes) {
+        if (nodes.contains(node)) updateNode(node);
+    }
+    batchNodes.clear();
+    if (conflicts != 0) throw std::logic_error("Tried to join two nets with inputs");
+}
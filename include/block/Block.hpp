@@ -1,4 +1,7 @@
+#pragma once
+
 #include "BlockInternals.hpp"
+#include "OccupancyGrid.hpp"
 
 using ObjAtCoord = std::variant<std::monostate, Connection, std::pair<Connection, Connection>,
                                    PortRef, Ref<Node>, Ref<Gate>, Ref<BlockInst>>;
@@ -29,10 +32,54 @@ inline bool isCoordConType(const ObjAtCoord& ref) {
 }
 
 class Block {
+  private:
+    OccupancyGrid                                occupancy;
+    absl::flat_hash_map<PortRef, Ref<ClosedNet>> portNets; // net each connected port belongs to
+
+    // batch state, see beginBatch()
+    bool                                                batching = false;
+    absl::flat_hash_map<Ref<ClosedNet>, Ref<ClosedNet>> batchNetParents; // union-find of nets
+    absl::flat_hash_set<Ref<Node>>                      batchNodes;      // to tidy on commit
+
+    Ref<ClosedNet> findBatchRoot(Ref<ClosedNet> net);
+
+    // edit counters so views can tell what changed since they last looked
+    std::uint64_t                                      generation = 0;
+    absl::flat_hash_map<Ref<ClosedNet>, std::uint64_t> netGenerations;
+
+    void touchNet(Ref<ClosedNet> net) { netGenerations.insert_or_assign(net, ++generation); }
+
+    // positions of recently added, removed or (dis)connected nodes with the generation of each
+    static constexpr std::size_t                 nodeEditLogSize  = 4096;
+    std::deque<std::pair<std::uint64_t, Vec2i>> nodeEdits;
+    std::uint64_t                                droppedNodeEdits = 0; // newest edit no longer held
+
+    void touchNode(const Vec2i& pos);
+    void touchConNodes(const Connection& con);
+
   protected:
-    bool collisionCheck(const Connection& con, const sf::Vector2i& coord) const;
+    bool collisionCheck(const Connection& con, const Vec2i& coord) const;
+
+    // all node and connection creation/destruction goes through these to keep occupancy current
+    Ref<Node> insertNode(const Vec2i& pos);
+    void      eraseNode(Ref<Node> node);
+    void      insertNetCon(Ref<ClosedNet> netRef, const Connection& con);
+    void      eraseNetCon(Ref<ClosedNet> netRef, const Connection& con);
+    // nets must only be added or combined through these to keep portNets current
+    Ref<ClosedNet> insertNet(ClosedNet&& net);
+    void           eraseNet(Ref<ClosedNet> netRef);
+    Ref<ClosedNet> mergeNets(Ref<ClosedNet> net1Ref, Ref<ClosedNet> net2Ref);
+    // merges straight away or records the merge for commit() if batching
+    Ref<ClosedNet> joinNets(Ref<ClosedNet> net1Ref, Ref<ClosedNet> net2Ref);
 
-    [[nodiscard]] PortRef makeNewPortRef(const sf::Vector2i& pos, Direction portDir);
+    // gate or block instance body at pos with these ports would sit on nothing else
+    [[nodiscard]] bool isFootprintFree(const Vec2i&                 pos,
+                                       const std::vector<PortInst>& objPorts) const;
+    void               erasePortCons(const PortObjRef& obj, std::size_t portCount);
+
+    void                  checkNewPort(const Vec2i& pos, Direction portDir) const;
+    [[nodiscard]] PortRef makeNewPortRef(const Vec2i& pos, Direction portDir);
+    [[nodiscard]] PortRef makePortRef(const Vec2i& pos, Direction portDir);
     void                  insertCon(const Connection& con);
     void                  splitCon(const Connection& con, Ref<Node> node);
     void                  updateNode(Ref<Node> node);
@@ -51,25 +98,66 @@ class Block {
     std::vector<Port>       ports;
 
     // PortInst&                     getPort(const PortRef& port);
-    const PortInst&               getPort(const PortRef& port) const;
+    PortInst                      getPort(const PortRef& port) const;
+    // as seen by the net the port is on
     PortType                      getPortType(const PortRef& port) const;
     std::pair<PortType, PortType> getPortType(const Connection& con) const;
-    [[nodiscard]] ObjAtCoord   whatIsAtCoord(const sf::Vector2i& coord) const;
+    [[nodiscard]] ObjAtCoord   whatIsAtCoord(const Vec2i& coord) const;
+    // range queries along a horizontal or vertical segment, ends excluded
+    [[nodiscard]] std::vector<Ref<Node>>  nodesBetween(const Vec2i& end1, const Vec2i& end2) const;
+    [[nodiscard]] std::vector<Connection> consAlong(const Vec2i& end1, const Vec2i& end2) const;
 
-    template <typename T>
-    [[nodiscard]] std::optional<Ref<ClosedNet>> getClosNetRef(const T& obj) const {
-        for (const auto& net: nets) {
-            if (net.obj.contains(obj)) return net.ind;
+    [[nodiscard]] std::optional<Ref<ClosedNet>> getClosNetRef(const PortRef& port) const {
+        auto it = portNets.find(port);
+        if (it == portNets.end()) return {};
+        return it->second;
+    }
+    [[nodiscard]] std::optional<Ref<ClosedNet>> getClosNetRef(const Ref<Node>& node) const {
+        for (std::size_t portNum = 0; portNum < 4; ++portNum) {
+            if (auto net = getClosNetRef(PortRef{node, portNum})) return net;
         }
         return {};
     }
+    [[nodiscard]] std::optional<Ref<ClosedNet>> getClosNetRef(const Connection& con) const {
+        auto net = getClosNetRef(con.portRef1);
+        if (net && nets[net.value()].contains(con)) return net;
+        return {};
+    }
     template <typename T>
     [[nodiscard]] bool contains(const T& obj) const {
         return getClosNetRef(obj).has_value();
     }
     [[nodiscard]] std::size_t getNodeConCount(const Ref<Node>& node) const;
 
-    Connection addConnection(const sf::Vector2i& startPos, const sf::Vector2i& endPos);
-    void insertOverlap(const Connection& con1, const Connection& con2, const sf::Vector2i& pos);
+    // Bumped on every edit, equal generations mean nothing has changed
+    [[nodiscard]] std::uint64_t getGeneration() const { return generation; }
+    // Generation of the last edit to net's connections, a reused Ref always gets a new one
+    [[nodiscard]] std::uint64_t getNetGeneration(Ref<ClosedNet> net) const {
+        auto it = netGenerations.find(net);
+        if (it == netGenerations.end()) throw std::logic_error("Net doesn't exist");
+        return it->second;
+    }
+    // Positions of nodes added, removed or (dis)connected after generation since, newest first
+    // Nothing if the log no longer goes back that far, so everything should be assumed changed
+    [[nodiscard]] std::optional<std::vector<Vec2i>> getNodeEditsSince(std::uint64_t since) const;
+
+    Connection addConnection(const Vec2i& startPos, const Vec2i& endPos);
+    void insertOverlap(const Connection& con1, const Connection& con2, const Vec2i& pos);
     void eraseCon(const Connection& con);
+    // gates and block instances can't overlap anything, erasing one erases the connections to
+    // its ports too
+    Ref<Gate>      insertGate(Gate gate);
+    void           eraseGate(Ref<Gate> gate);
+    Ref<BlockInst> insertBlockInst(BlockInst inst);
+    void           eraseBlockInst(Ref<BlockInst> inst);
+
+    // Batch editing for bulk construction
+    // Between beginBatch() and commit() addConnection and insertOverlap don't merge nets or remove
+    // redundant nodes, commit() does all of it in one pass. Until then nets may be fragmented and
+    // returned connections may later be combined. eraseCon isn't allowed while batching
+    // If the batch joins two driven nets commit() leaves those nets unjoined, commits the rest,
+    // closes the batch and then throws
+    void               beginBatch();
+    void               commit();
+    [[nodiscard]] bool isBatching() const { return batching; }
 };
\ No newline at end of file
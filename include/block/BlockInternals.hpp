@@ -1,47 +1,93 @@
 #pragma once
 
+#include <deque>
+#include <string>
+#include <variant>
+
 #include "Helpers.hpp"
 #include "absl/container/flat_hash_set.h"
+#include "absl/hash/hash.h"
 #include "details/StableVector.hpp"
 
-enum struct PortType { input, output, node };
+// gate ports store the gate's side, their net sees it the other way round (Block::getPortType)
+enum struct PortType : std::uint8_t { input, output, node };
 
 struct PortInst {
-    Direction    portDir;
-    sf::Vector2i portPos;
-    // PortType     portType;
-    bool negated = false;
+    Vec2i     portPos;
+    Direction portDir;
+    PortType  portType = PortType::node;
+    bool      negated  = false;
 };
+static_assert(sizeof(PortInst) == 12);
 
+// a node's 4 ports are all at its pos, one per direction, so they are made on request
 struct Node {
-    sf::Vector2i            pos;
-    std::array<PortInst, 4> ports;
+    static constexpr std::array<Direction, 4> portDirs{Direction::up, Direction::down,
+                                                       Direction::left, Direction::right};
+    Vec2i pos;
 
     // ALWAYS form a connection to node after construction
-    Node(const sf::Vector2i& pos_) : pos(pos_) {
-        ports[0] = {Direction::up, pos};
-        ports[1] = {Direction::down, pos};
-        ports[2] = {Direction::left, pos};
-        ports[3] = {Direction::right, pos};
-    }
+    Node(const Vec2i& pos_) : pos(pos_) {}
+
+    [[nodiscard]] PortInst getPort(std::size_t portNum) const { return {pos, Direction(portNum)}; }
 };
 
+enum struct GateType : std::uint8_t { And, Or, Xor, Not };
+static constexpr std::array<std::string, 4> GateTypeStrings{"and", "or", "xor", "not"};
+
+// body at pos, inputs stacked down from pos on its left facing left, output on its right
+// wires must leave a gate port in the direction it faces
 struct Gate {
-    sf::Vector2i          pos;
-    std::vector<PortInst> ports;
+    GateType              type{};
+    std::uint8_t          delay = 1; // ticks from an input changing to the output changing
+    Vec2i                 pos;
+    std::vector<PortInst> ports; // inputs then the output
+
+    Gate() = default;
+    Gate(GateType type_, const Vec2i& pos_, std::size_t inputCount) : type(type_), pos(pos_) {
+        if (inputCount == 0 || (type == GateType::Not && inputCount != 1))
+            throw std::logic_error("Gate has the wrong number of inputs for its type");
+        for (std::size_t i = 0; i < inputCount; ++i) {
+            ports.push_back(
+                {pos + Vec2i{-1, static_cast<int>(i)}, Direction::left, PortType::input});
+        }
+        ports.push_back({pos + Vec2i{1, 0}, Direction::right, PortType::output});
+    }
+
+    [[nodiscard]] std::size_t inputCount() const { return ports.size() - 1; }
+    [[nodiscard]] std::size_t outputPortNum() const { return ports.size() - 1; }
 };
 
 class Block;
 
+// one of a block's inputs or outputs, joined to whichever net is at pos inside the block
 struct Port {
     std::string name;
     PortType    type;
+    Vec2i       pos;
 };
 
+// placed copy of another block, laid out like a gate with its inputs stacked down the left and
+// its outputs down the right, port i is the block's ports[i]
 struct BlockInst {
-    sf::Vector2i          pos;
+    Vec2i                 pos;
     std::vector<PortInst> ports;
     Ref<Block>            block;
+
+    BlockInst(Ref<Block> block_, const std::vector<Port>& blockPorts, const Vec2i& pos_)
+        : pos(pos_), block(block_) {
+        int inputs  = 0;
+        int outputs = 0;
+        for (const auto& port: blockPorts) {
+            if (port.type == PortType::node)
+                throw std::logic_error("Block ports must be inputs or outputs");
+            if (port.type == PortType::input) {
+                ports.push_back({pos + Vec2i{-1, inputs++}, Direction::left, PortType::input});
+            } else {
+                ports.push_back({pos + Vec2i{1, outputs++}, Direction::right, PortType::output});
+            }
+        }
+    }
 };
 
 using PortObjRef = std::variant<Ref<Node>, Ref<Gate>, Ref<BlockInst>>;
@@ -49,23 +95,58 @@ enum struct PortObjType : std::size_t { Node = 0, Gate = 1, BlockInst = 2 };
 static constexpr std::array<std::string, 3> PortObjRefStrings{"node", "gate", "block"};
 inline PortObjType typeOf(const PortObjRef& ref) { return PortObjType(ref.index()); }
 
-struct PortRef {
-    PortObjRef  ref;
-    std::size_t portNum;
-    PortRef(PortObjRef ref_, std::size_t portNum_) : ref(ref_), portNum(portNum_) {}
+// Port of a node, gate or block instance packed into 64 bits so it's cheap to store and hash
+// bits 0-1: object type, bits 2-15: port number, bits 16-63: object index
+class PortRef {
+    static constexpr unsigned typeBits = 2;
+    static constexpr unsigned portBits = 14;
+    static constexpr unsigned refShift = typeBits + portBits;
+
+    std::uint64_t key;
 
-    bool operator==(const PortRef& other) const {
-        return (ref == other.ref) && (portNum == other.portNum);
+    static std::uint64_t pack(const PortObjRef& ref, std::size_t portNum) {
+        assert(portNum < (1U << portBits));
+        auto id = std::visit([](const auto& obj) { return static_cast<std::size_t>(obj); }, ref);
+        assert(id < (std::uint64_t{1} << (64 - refShift)));
+        return (static_cast<std::uint64_t>(id) << refShift) | (portNum << typeBits) | ref.index();
+    }
+
+  public:
+    PortRef(const PortObjRef& ref_, std::size_t portNum_) : key(pack(ref_, portNum_)) {}
+
+    [[nodiscard]] PortObjType type() const {
+        return PortObjType(key & ((1U << typeBits) - 1));
+    }
+    [[nodiscard]] std::size_t portNum() const {
+        return static_cast<std::size_t>((key >> typeBits) & ((1U << portBits) - 1));
+    }
+    [[nodiscard]] PortObjRef ref() const {
+        auto id = static_cast<std::size_t>(key >> refShift);
+        switch (type()) {
+        case PortObjType::Node:
+            return Ref<Node>(id);
+        case PortObjType::Gate:
+            return Ref<Gate>(id);
+        case PortObjType::BlockInst:
+            return Ref<BlockInst>(id);
+        }
+        throw std::logic_error("Port type not handled in PortRef::ref");
+    }
+
+    auto operator<=>(const PortRef&) const = default;
+
+    template <typename H>
+    friend H AbslHashValue(H h, const PortRef& port) {
+        return H::combine(std::move(h), port.key);
     }
 };
+static_assert(sizeof(PortRef) == sizeof(std::uint64_t));
 
-inline PortObjType typeOf(const PortRef& ref) { return typeOf(ref.ref); }
+inline PortObjType typeOf(const PortRef& ref) { return ref.type(); }
 
 template <>
 struct std::hash<PortRef> {
-    std::size_t operator()(const PortRef& portRef) const {
-        return std::hash<PortObjRef>{}(portRef.ref) + std::hash<std::size_t>{}(portRef.portNum);
-    }
+    std::size_t operator()(const PortRef& portRef) const { return absl::Hash<PortRef>{}(portRef); }
 };
 
 class Connection {
@@ -75,32 +156,86 @@ class Connection {
 
     bool operator==(const Connection& other) const { // compare is commutative
         return (portRef1 == other.portRef1 && portRef2 == other.portRef2) ||
-               (portRef1 == other.portRef2 && portRef1 == other.portRef2);
+               (portRef1 == other.portRef2 && portRef2 == other.portRef1);
     }
 
     Connection getSwapped() const { return {portRef2, portRef1}; }
+
+    template <typename H>
+    friend H AbslHashValue(H h, const Connection& con) { // hash function commutative
+        auto [low, high] = std::minmax(con.portRef1, con.portRef2);
+        return H::combine(std::move(h), low, high);
+    }
 };
 
 template <>
-struct std::hash<Connection> { // hash function commutative
-    std::size_t operator()(const Connection& con) const {
-        return std::hash<PortRef>{}(con.portRef1) + std::hash<PortRef>{}(con.portRef2);
-    }
+struct std::hash<Connection> {
+    std::size_t operator()(const Connection& con) const { return absl::Hash<Connection>{}(con); }
 };
 
 class ClosedNet {
   private:
-    absl::flat_hash_map<PortRef, PortRef> conMap{};
-    absl::flat_hash_map<PortRef, PortRef> conMap2{};
-    std::optional<PortRef>                input{}; // only 1 allowed atm
-    std::vector<PortRef>                  outputs{};
-    std::size_t                           size{};
+    // Each con is stored once in cons, slots is an open addressing table over both of its ports
+    // A slot holds 2 * con index + which end + 1, 0 is empty. Linear probing with backward shift
+    // deletion, so there are no tombstones and erasing keeps lookups short.
+    std::vector<Connection>    cons{};
+    std::vector<std::uint32_t> slots{}; // power of two size, at most 3/4 full, < 2^31 cons
+    std::optional<PortRef>     input{}; // only 1 allowed atm
+    std::vector<PortRef>       outputs{};
+
+    [[nodiscard]] const Connection& conOf(std::uint32_t slot) const {
+        return cons[(slot - 1) >> 1U];
+    }
+    [[nodiscard]] const PortRef& endOf(std::uint32_t slot) const {
+        return ((slot - 1) & 1U) != 0 ? conOf(slot).portRef2 : conOf(slot).portRef1;
+    }
+    [[nodiscard]] std::size_t homeOf(const PortRef& port) const {
+        return absl::Hash<PortRef>{}(port) & (slots.size() - 1);
+    }
+    // slot holding port, or the empty one it would go in
+    [[nodiscard]] std::size_t findSlot(const PortRef& port) const {
+        auto mask = slots.size() - 1;
+        for (auto i = homeOf(port);; i = (i + 1) & mask) {
+            if (slots[i] == 0 || endOf(slots[i]) == port) return i;
+        }
+    }
+    [[nodiscard]] std::optional<std::size_t> findPort(const PortRef& port) const {
+        if (slots.empty()) return {};
+        auto i = findSlot(port);
+        if (slots[i] == 0) return {};
+        return i;
+    }
+    void placeEnds(std::size_t conIndex) {
+        const auto& con = cons[conIndex];
+        slots[findSlot(con.portRef1)] = static_cast<std::uint32_t>(2 * conIndex + 1);
+        slots[findSlot(con.portRef2)] = static_cast<std::uint32_t>(2 * conIndex + 2);
+    }
+    void reserveSlots(std::size_t conCount) {
+        auto wanted = std::max<std::size_t>(slots.size(), 8);
+        while (4 * 2 * conCount > 3 * wanted) wanted *= 2;
+        if (wanted == slots.size()) return;
+        slots.assign(wanted, 0);
+        for (std::size_t i = 0; i < cons.size(); ++i) placeEnds(i);
+    }
+    // moves later slots back over the gap unless that would put them before their home
+    void eraseSlot(std::size_t gap) {
+        auto mask = slots.size() - 1;
+        for (auto i = (gap + 1) & mask; slots[i] != 0; i = (i + 1) & mask) {
+            auto home = homeOf(endOf(slots[i]));
+            if (((i - home) & mask) >= ((i - gap) & mask)) {
+                slots[gap] = slots[i];
+                gap        = i;
+            }
+        }
+        slots[gap] = 0;
+    }
 
     void maintainIOVecs(bool isInsert, const PortRef& portRef, const PortType& portType) {
         if (portType == PortType::node) return;
         if (portType == PortType::input) {
             if (isInsert) {
                 if (input) throw std::logic_error("Tried to add two inputs to closed graph");
+                input = portRef;
             } else {
                 input.reset();
             }
@@ -109,50 +244,31 @@ class ClosedNet {
                 outputs.push_back(portRef);
             } else {
                 auto it = std::find(outputs.begin(), outputs.end(), portRef);
-                if (it != outputs.end())
+                if (it == outputs.end())
                     throw std::logic_error("Tried to remove output that isn't in closed graph");
-                std::erase(outputs, *it);
+                outputs.erase(it);
             }
         }
     }
-    bool isConnected(const PortRef& start, const PortRef& end,
-                     absl::flat_hash_set<PortRef>& alreadyChecked) const {
-        if (start == end) return true;
-        if (alreadyChecked.contains(start)) return false;
-        alreadyChecked.insert(start);
-        if (typeOf(start) != PortObjType::Node) { // if start not node
-            return contains(start) && isConnected(getCon(start).portRef2, end, alreadyChecked);
-        } else if (typeOf(start) == PortObjType::Node) { // if start node
-            for (std::size_t portNum = 0; portNum < 4; ++portNum) {
-                PortRef nodePort{start.ref, portNum};
-                if (nodePort == end) return true;
-                alreadyChecked.insert(nodePort);
-                if (contains(nodePort) &&
-                    isConnected(getCon(nodePort).portRef2, end, alreadyChecked)) {
-                    return true;
-                }
-            }
-        }
-        return false;
-    }
-
-    void stealConnetedCons(const PortRef& currentPort, ClosedNet& newNet) {
-        if (contains(currentPort) && !newNet.contains(currentPort)) {
-            auto currentCon = getCon(currentPort);
+    // moves every con reachable from startPort into newNet
+    // uses an explicit stack so long wire chains can't overflow the call stack
+    void stealConnetedCons(const PortRef& startPort, ClosedNet& newNet) {
+        std::vector<PortRef> toVisit{startPort};
+        auto                 steal = [&](const PortRef& port) {
+            if (!contains(port)) return;
+            auto currentCon = getCon(port);
             // don't update input/output for now
             newNet.insert(currentCon, {PortType::node, PortType::node});
             erase(currentCon, {PortType::node, PortType::node});
-            stealConnetedCons(currentCon.portRef2, newNet);
-        }
-        if (typeOf(currentPort) == PortObjType::Node) {
-            for (std::size_t portNum = 0; portNum < 4; ++portNum) {
-                PortRef nodePort{currentPort.ref, portNum};
-                if (contains(nodePort) && !newNet.contains(nodePort)) {
-                    auto currentCon = getCon(nodePort);
-                    // don't update input/output for now
-                    newNet.insert(currentCon, {PortType::node, PortType::node});
-                    erase(currentCon, {PortType::node, PortType::node});
-                    stealConnetedCons(currentCon.portRef2, newNet);
+            toVisit.push_back(currentCon.portRef2);
+        };
+        while (!toVisit.empty()) {
+            auto currentPort = toVisit.back();
+            toVisit.pop_back();
+            steal(currentPort);
+            if (typeOf(currentPort) == PortObjType::Node) {
+                for (std::size_t portNum = 0; portNum < 4; ++portNum) {
+                    steal(PortRef{currentPort.ref(), portNum});
                 }
             }
         }
@@ -164,26 +280,37 @@ class ClosedNet {
     [[nodiscard]] bool                          hasInput() const { return input.has_value(); }
     [[nodiscard]] const std::optional<PortRef>& getInput() const { return input; }
     [[nodiscard]] const std::vector<PortRef>&   getOutputs() const { return outputs; }
-    [[nodiscard]] std::size_t                   getSize() const { return size; }
+    [[nodiscard]] std::size_t                   getSize() const { return cons.size(); }
 
     void insert(const Connection& con, const std::pair<PortType, PortType>& portTypes) {
-        conMap.insert({con.portRef1, con.portRef2});
-        conMap2.insert({con.portRef2, con.portRef1});
-        ++size;
+        if (contains(con)) return;
+        if (contains(con.portRef1) || contains(con.portRef2))
+            throw std::logic_error("Tried to insert con on a port that is already connected");
+        reserveSlots(cons.size() + 1);
+        cons.push_back(con);
+        placeEnds(cons.size() - 1);
         maintainIOVecs(true, con.portRef1, portTypes.first);
         maintainIOVecs(true, con.portRef2, portTypes.second);
     }
 
+    // the last con takes the erased one's place so cons stays dense
     void erase(const Connection& con, const std::pair<PortType, PortType>& portTypes) {
-        conMap.erase(con.portRef1);
-        conMap.erase(con.portRef2);
-        conMap2.erase(con.portRef1);
-        conMap2.erase(con.portRef2);
-        --size;
+        auto slot = findPort(con.portRef1);
+        if (!slot || conOf(slots[slot.value()]) != con)
+            throw std::logic_error("Tried to erase con that isn't in closed net");
+        std::size_t conIndex = (slots[slot.value()] - 1) >> 1U;
+        eraseSlot(slot.value());
+        eraseSlot(findSlot(con.portRef2));
+        if (conIndex + 1 != cons.size()) {
+            cons[conIndex] = cons.back();
+            placeEnds(conIndex); // finds the back's slots as it's still there
+        }
+        cons.pop_back();
         maintainIOVecs(false, con.portRef1, portTypes.first);
         maintainIOVecs(false, con.portRef2, portTypes.second);
     }
 
+    // Moves the component containing startPort into a new net
     ClosedNet splitNet(const PortRef& startPort) {
         ClosedNet newNet{};
         stealConnetedCons(startPort, newNet);
@@ -202,13 +329,17 @@ class ClosedNet {
         }
         return newNet;
     }
-    [[nodiscard]] bool contains(const PortRef& port) const {
-        return conMap.contains(port) || conMap2.contains(port);
+    // Splits off whichever component of port1 and port2 is smaller
+    // Returns nothing if they are still connected
+    std::optional<ClosedNet> splitNet(const PortRef& port1, const PortRef& port2) {
+        auto smallerSide = findSmallerSide(port1, port2);
+        if (!smallerSide) return {};
+        return splitNet(smallerSide.value());
     }
+    [[nodiscard]] bool contains(const PortRef& port) const { return findPort(port).has_value(); }
     [[nodiscard]] bool contains(const Connection& con) const {
-        return (conMap.contains(con.portRef1) &&
-                conMap.find(con.portRef1)->second == con.portRef2) ||
-               (conMap.contains(con.portRef2) && conMap.find(con.portRef2)->second == con.portRef1);
+        auto slot = findPort(con.portRef1);
+        return slot && conOf(slots[slot.value()]) == con;
     }
     // prefer call contains() on port
     [[nodiscard]] bool contains(const Ref<Node> node) const {
@@ -216,75 +347,57 @@ class ClosedNet {
                contains(PortRef{node, 2}) || contains(PortRef{node, 3});
     }
     bool isConnected(const PortRef& start, const PortRef& end) const {
-        // if (!contains(start) || !contains(end)) return false;
-        absl::flat_hash_set<PortRef> alreadyChecked{};
-        return isConnected(start, end, alreadyChecked);
+        return !findSmallerSide(start, end).has_value();
     }
-    [[nodiscard]] Connection getCon(const PortRef& port) const {
-        if (conMap.contains(port)) {
-            return Connection{port, conMap.find(port)->second};
-        } else if (conMap2.contains(port)) {
-            return Connection{port, conMap2.find(port)->second};
+    // Searches breadth first outwards from both ports in lockstep, one port per side at a time,
+    // so when they are still connected the searches meet near the cut.
+    // Returns nothing if the searches meet (still connected), otherwise the port whose search ran
+    // out first, which is on the smaller component. Cost is proportional to the smaller component.
+    [[nodiscard]] std::optional<PortRef> findSmallerSide(const PortRef& port1,
+                                                         const PortRef& port2) const {
+        if (port1 == port2) return {};
+        std::array<std::deque<PortRef>, 2>          toVisit{{{port1}, {port2}}};
+        std::array<absl::flat_hash_set<PortRef>, 2> seen{{{port1}, {port2}}};
+        for (std::size_t side = 0;; side ^= 1U) {
+            if (toVisit[side].empty()) return side == 0 ? port1 : port2;
+            auto current = toVisit[side].front();
+            toVisit[side].pop_front();
+            auto reach = [&](const PortRef& next) { // returns true if other side reached
+                if (seen[side ^ 1U].contains(next)) return true;
+                if (seen[side].insert(next).second) toVisit[side].push_back(next);
+                return false;
+            };
+            if (contains(current) && reach(getCon(current).portRef2)) return {};
+            if (typeOf(current) == PortObjType::Node) {
+                for (std::size_t portNum = 0; portNum < 4; ++portNum) {
+                    if (reach(PortRef{current.ref(), portNum})) return {};
+                }
+            }
         }
-        throw std::logic_error("Port not connected to closed net. Did you call contains?");
+    }
+    // portRef1 of the returned con is port
+    [[nodiscard]] Connection getCon(const PortRef& port) const {
+        auto slot = findPort(port);
+        if (!slot)
+            throw std::logic_error("Port not connected to closed net. Did you call contains?");
+        const auto& con = conOf(slots[slot.value()]);
+        return con.portRef1 == port ? con : Connection{port, con.portRef1};
     }
 
     // NOTE: Destroys network "other". Adds all connections from another network
     void operator+=(const ClosedNet& other) {
-        for (const auto& con: other.conMap) {
-            insert({con.first, con.second}, {PortType::node, PortType::node});
+        if (input && other.input) throw std::logic_error("Tried to join two nets with inputs");
+        reserveSlots(cons.size() + other.cons.size());
+        for (const auto& con: other.cons) {
+            cons.push_back(con);
+            placeEnds(cons.size() - 1);
         }
-        conMap.begin();
+        if (other.input) input = other.input;
+        outputs.insert(outputs.end(), other.outputs.begin(), other.outputs.end());
     }
 
-    // const iterator to loop over connections
-    struct Iterator {
-        using iterator_category = std::input_iterator_tag;
-        using difference_type   = std::ptrdiff_t;
-        using value_type        = Connection;
-        using pointer           = const Connection*; // or also value_type*
-        using reference         = const Connection&; // or also value_type&
-
-        using MapIt = absl::flat_hash_map<PortRef, PortRef>::const_iterator;
-        Iterator()  = delete;
-        Iterator(MapIt it, MapIt end) : it_(it), end_(end) {
-            if (it_ != end_) con = Connection(it_->first, it_->second);
-        }
-
-        [[nodiscard]] reference operator*() const {
-            if (it_ == end_) throw std::out_of_range("Tried to derefence end");
-            return con.value();
-        }
-        [[nodiscard]] pointer operator->() const {
-            if (it_ == end_) throw std::out_of_range("Tried to derefence end");
-            return &con.value();
-        }
-
-        Iterator& operator++() { // Prefix increment
-            ++it_;
-            if (it_ != end_)
-                con = Connection(it_->first, it_->second);
-            else
-                con = {};
-            return *this;
-        }
-
-        Iterator operator++(int) { // Postfix increment
-            Iterator tmp = *this;
-            ++*this;
-            return tmp;
-        }
-
-        friend bool operator==(const Iterator& a, const Iterator& b) { return a.it_ == b.it_; }
-        friend bool operator!=(const Iterator& a, const Iterator& b) { return a.it_ != b.it_; }
-
-      private:
-        MapIt                     it_;
-        MapIt                     end_; // required to avoid dereference of end()
-        std::optional<Connection> con;
-    };
-
-    static_assert(std::input_iterator<Iterator>);
-    [[nodiscard]] Iterator begin() const { return Iterator(conMap.begin(), conMap.end()); }
-    [[nodiscard]] Iterator end() const { return Iterator(conMap.end(), conMap.end()); }
+    // loops over connections, invalidated by any insert or erase
+    using Iterator = std::vector<Connection>::const_iterator;
+    [[nodiscard]] Iterator begin() const { return cons.begin(); }
+    [[nodiscard]] Iterator end() const { return cons.end(); }
 };
\ No newline at end of file
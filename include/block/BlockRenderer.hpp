@@ -0,0 +1,318 @@
+#pragma once
+
+#include <cmath>
+#include <filesystem>
+#include <limits>
+#include <numbers>
+#include <stdexcept>
+#include <string>
+
+#include <SFML/Graphics/Image.hpp>
+#include <SFML/Graphics/RenderTarget.hpp>
+#include <SFML/Graphics/RenderTexture.hpp>
+#include <SFML/Graphics/VertexBuffer.hpp>
+
+#include "absl/container/node_hash_map.h"
+
+#include "Block.hpp"
+#include "SfmlVec2.hpp"
+#include "details/Profiler.hpp"
+
+// inclusive of touching edges, unlike sf::Rect::findIntersection, so flat lines aren't culled
+inline bool overlaps(const sf::FloatRect& a, const sf::FloatRect& b) {
+    return a.position.x <= b.position.x + b.size.x && b.position.x <= a.position.x + a.size.x &&
+           a.position.y <= b.position.y + b.size.y && b.position.y <= a.position.y + a.size.y;
+}
+
+inline sf::FloatRect boundsOf(const std::vector<sf::Vertex>& verts) {
+    if (verts.empty()) return {};
+    sf::Vector2f min = verts.front().position;
+    sf::Vector2f max = min;
+    for (const auto& vert: verts) {
+        min = {std::min(min.x, vert.position.x), std::min(min.y, vert.position.y)};
+        max = {std::max(max.x, vert.position.x), std::max(max.y, vert.position.y)};
+    }
+    return {min, max - min};
+}
+
+// Draws the static content of a block (wires, junctions and border) to any sf::RenderTarget
+// Geometry is cached on the GPU per net and per chunk of junctions and only rebuilt for what the
+// block reports has changed. Shared by the editor window and offscreen export
+class BlockRenderer {
+  public:
+    static constexpr std::size_t nodePointCount = 12;
+
+    float     nodeRad    = 0.1f;
+    sf::Color nodeColour = sf::Color::White;
+    sf::Color conColour  = sf::Color::White;
+
+  private:
+    const Block& block;
+
+    // connection geometry per net, only rebuilt when the block says the net has changed
+    struct NetVerts {
+        sf::VertexBuffer        buffer{sf::PrimitiveType::Lines, sf::VertexBuffer::Usage::Static};
+        std::vector<sf::Vertex> verts; // used instead of buffer when the GPU doesn't support them
+        std::uint64_t           generation = 0;
+        sf::FloatRect           bounds;    // for culling
+    };
+    absl::node_hash_map<Ref<ClosedNet>, NetVerts> netVerts;
+
+    std::uint64_t              syncedGeneration = std::numeric_limits<std::uint64_t>::max();
+    bool                       useVertexBuffers = sf::VertexBuffer::isAvailable();
+    std::vector<sf::Vertex>    scratchVerts;
+    std::vector<sf::FloatRect> changedAreas;
+
+    // junction nodes (not exactly 2 connections) only change when the block does
+    // they are split into square chunks of coords so ones outside the drawn area can be skipped
+    // and only chunks with edited nodes in are rebuilt
+    static constexpr int chunkSize = 64;
+    struct JunctionChunk {
+        sf::VertexBuffer        buffer{sf::PrimitiveType::Triangles,
+                                sf::VertexBuffer::Usage::Static};
+        std::vector<sf::Vertex> verts;
+    };
+    absl::node_hash_map<Vec2i, JunctionChunk> junctionChunks;
+
+    std::array<sf::Vertex, 5> borderVerts;
+
+    static void upload(sf::VertexBuffer& buffer, const std::vector<sf::Vertex>& verts) {
+        if (buffer.getVertexCount() != verts.size() && !buffer.create(verts.size()))
+            throw std::runtime_error("Failed to create vertex buffer");
+        if (!verts.empty() && !buffer.update(verts.data()))
+            throw std::runtime_error("Failed to upload vertex buffer");
+    }
+
+    static Vec2i chunkOf(const Vec2i& pos) {
+        auto floorDiv = [](int a) { return a / chunkSize - (a % chunkSize < 0 ? 1 : 0); };
+        return {floorDiv(pos.x), floorDiv(pos.y)};
+    }
+
+    [[nodiscard]] sf::FloatRect chunkBounds(const Vec2i& key) const {
+        auto size = static_cast<float>(chunkSize - 1) + nodeRad * 2.0f;
+        return {sf::Vector2f(toSf(key * chunkSize)) - sf::Vector2f{nodeRad, nodeRad}, {size, size}};
+    }
+
+    void uploadChunk(const Vec2i& key, JunctionChunk& chunk) {
+        if (chunk.verts.empty()) {
+            junctionChunks.erase(key);
+        } else if (useVertexBuffers) {
+            upload(chunk.buffer, chunk.verts);
+        }
+    }
+
+    void appendJunction(std::vector<sf::Vertex>& verts, Ref<Node> node) const {
+        if (block.getNodeConCount(node) != 2) {
+            appendCircle(verts, block.nodes[node].pos, nodeRad, nodeColour);
+        }
+    }
+
+    void rebuildChunk(const Vec2i& key) {
+        auto& chunk  = junctionChunks[key];
+        auto  origin = key * chunkSize;
+        chunk.verts.clear();
+        for (int y = origin.y; y < origin.y + chunkSize; ++y) { // ends are excluded
+            for (auto node: block.nodesBetween({origin.x - 1, y}, {origin.x + chunkSize, y})) {
+                appendJunction(chunk.verts, node);
+            }
+        }
+        uploadChunk(key, chunk);
+    }
+
+    void syncJunctions() {
+        PROFILE_SCOPE("syncJunctions");
+        std::optional<std::vector<Vec2i>> edits;
+        if (syncedGeneration != std::numeric_limits<std::uint64_t>::max()) {
+            edits = block.getNodeEditsSince(syncedGeneration);
+        }
+        if (edits) {
+            absl::flat_hash_set<Vec2i> dirty;
+            for (const auto& pos: edits.value()) dirty.insert(chunkOf(pos));
+            for (const auto& key: dirty) rebuildChunk(key);
+            return;
+        }
+        // first sync or too much has changed to say what, start again
+        junctionChunks.clear();
+        for (const auto& node: block.nodes) {
+            appendJunction(junctionChunks[chunkOf(node.obj.pos)].verts, node.ind);
+        }
+        std::vector<Vec2i> keys;
+        for (const auto& [key, chunk]: junctionChunks) keys.push_back(key);
+        for (const auto& key: keys) uploadChunk(key, junctionChunks[key]);
+    }
+
+    // records the old and new geometry of changed nets in changedAreas
+    void syncNetVerts() {
+        PROFILE_SCOPE("syncNetVerts");
+        absl::erase_if(netVerts, [&](const auto& entry) {
+            if (block.nets.contains(entry.first)) return false;
+            changedAreas.push_back(entry.second.bounds);
+            return true;
+        });
+        for (const auto& net: block.nets) {
+            auto  generation = block.getNetGeneration(net.ind);
+            auto& cached     = netVerts[net.ind];
+            if (cached.generation == generation) continue;
+            if (cached.generation != 0) changedAreas.push_back(cached.bounds);
+            cached.generation = generation;
+            auto& verts       = useVertexBuffers ? scratchVerts : cached.verts;
+            buildNetVerts(net.obj, conColour, verts);
+            cached.bounds = boundsOf(verts);
+            changedAreas.push_back(cached.bounds);
+            if (useVertexBuffers) upload(cached.buffer, verts);
+        }
+    }
+
+  public:
+    explicit BlockRenderer(const Block& block_) : block(block_) {
+        auto size      = static_cast<float>(block.size);
+        borderVerts[0] = {{-1.0f, -1.0f}};
+        borderVerts[1] = {{-1.0f, size}};
+        borderVerts[2] = {{size, size}};
+        borderVerts[3] = {{size, -1.0f}};
+        borderVerts[4] = {{-1.0f, -1.0f}};
+    }
+
+    // border plus a margin for junctions on it, everything drawn lies within this
+    [[nodiscard]] sf::FloatRect blockArea() const {
+        auto size = static_cast<float>(block.size) + 1.0f + nodeRad * 2.0f;
+        return {{-1.0f - nodeRad, -1.0f - nodeRad}, {size, size}};
+    }
+
+    // appends a circle as a fan of triangles, so any number of nodes go in a single draw call
+    static void appendCircle(std::vector<sf::Vertex>& verts, const Vec2i& pos, float radius,
+                             const sf::Color& col) {
+        static const auto unitCircle = [] {
+            std::array<sf::Vector2f, nodePointCount> points;
+            for (std::size_t i = 0; i < nodePointCount; ++i) {
+                float angle = 2.0f * std::numbers::pi_v<float> * static_cast<float>(i) /
+                              static_cast<float>(nodePointCount);
+                points[i]   = {std::cos(angle), std::sin(angle)};
+            }
+            return points;
+        }();
+        sf::Vector2f centre{toSf(pos)};
+        for (std::size_t i = 0; i < nodePointCount; ++i) {
+            verts.emplace_back(centre, col);
+            verts.emplace_back(centre + unitCircle[i] * radius, col);
+            verts.emplace_back(centre + unitCircle[(i + 1) % nodePointCount] * radius, col);
+        }
+    }
+
+    void buildNetVerts(const ClosedNet& net, const sf::Color& col,
+                       std::vector<sf::Vertex>& verts) const {
+        verts.clear();
+        verts.reserve(net.getSize() * 2);
+        for (const auto& con: net) {
+            verts.emplace_back(sf::Vector2f(toSf(block.getPort(con.portRef1).portPos)), col);
+            verts.emplace_back(sf::Vector2f(toSf(block.getPort(con.portRef2).portPos)), col);
+        }
+    }
+
+    // brings the cached geometry up to date with block, does nothing unless it has been edited
+    // returns the areas whose drawing has changed since the last sync
+    const std::vector<sf::FloatRect>& sync() {
+        changedAreas.clear();
+        if (block.getGeneration() == syncedGeneration) return changedAreas;
+        syncNetVerts();
+        syncJunctions();
+        syncedGeneration = block.getGeneration();
+        return changedAreas;
+    }
+
+    // draws wires and junctions overlapping area, sync() first
+    void draw(sf::RenderTarget& target, const sf::FloatRect& area) const {
+        for (const auto& [netRef, net]: netVerts) {
+            if (!overlaps(net.bounds, area)) continue;
+            if (useVertexBuffers) {
+                target.draw(net.buffer);
+            } else {
+                target.draw(net.verts.data(), net.verts.size(), sf::PrimitiveType::Lines);
+            }
+        }
+        for (const auto& [key, chunk]: junctionChunks) {
+            if (!overlaps(chunkBounds(key), area)) continue;
+            if (useVertexBuffers) {
+                target.draw(chunk.buffer);
+            } else {
+                target.draw(chunk.verts.data(), chunk.verts.size(), sf::PrimitiveType::Triangles);
+            }
+        }
+    }
+
+    void drawBorder(sf::RenderTarget& target) const {
+        target.draw(borderVerts.data(), borderVerts.size(), sf::PrimitiveType::LineStrip);
+    }
+};
+
+struct ImageExportSettings {
+    float     pixPerCoord = 16.0f;
+    unsigned  tilePixels  = 4096; // images bigger than this are split into tiles
+    sf::Color background  = sf::Color::Black;
+};
+
+// Renders block offscreen to PNG, one tile at a time so memory use doesn't grow with block size
+// If it fits in one tile it is written to path, otherwise tiles are written next to it as
+// <stem>_<row>_<col><extension>. Returns the files written
+// No window is opened, but SFML still needs a display to make its OpenGL context, so this isn't
+// fully headless: on a machine without one run under a virtual display such as Xvfb
+inline std::vector<std::filesystem::path>
+exportBlockImage(const Block& block, const std::filesystem::path& path,
+                 const ImageExportSettings& settings = {}) {
+    BlockRenderer renderer{block};
+    renderer.sync();
+
+    auto area       = renderer.blockArea();
+    auto totalPix   = static_cast<unsigned>(std::ceil(area.size.x * settings.pixPerCoord));
+    auto tileCount  = (totalPix + settings.tilePixels - 1) / settings.tilePixels;
+    auto tileCoords = static_cast<float>(settings.tilePixels) / settings.pixPerCoord;
+
+    sf::RenderTexture texture;
+    if (!texture.resize({std::min(totalPix, settings.tilePixels),
+                         std::min(totalPix, settings.tilePixels)}))
+        throw std::runtime_error("Failed to create export texture");
+
+    std::vector<std::filesystem::path> written;
+    for (unsigned row = 0; row < tileCount; ++row) {
+        for (unsigned col = 0; col < tileCount; ++col) {
+            // last row and column are cropped to the block
+            auto         remaining = [&](unsigned index) {
+                return std::min(settings.tilePixels, totalPix - index * settings.tilePixels);
+            };
+            sf::Vector2u tileSize{remaining(col), remaining(row)};
+            sf::FloatRect tileArea{
+                area.position + sf::Vector2f{static_cast<float>(col), static_cast<float>(row)} *
+                                    tileCoords,
+                sf::Vector2f(tileSize) / settings.pixPerCoord};
+            sf::View view(tileArea);
+            // map onto the top left of the texture when cropped
+            view.setViewport({{0.0f, 0.0f},
+                              {static_cast<float>(tileSize.x) /
+                                   static_cast<float>(texture.getSize().x),
+                               static_cast<float>(tileSize.y) /
+                                   static_cast<float>(texture.getSize().y)}});
+            texture.setView(view);
+            texture.clear(settings.background);
+            renderer.draw(texture, tileArea);
+            renderer.drawBorder(texture);
+            texture.display();
+
+            sf::Image image = texture.getTexture().copyToImage();
+            if (tileSize != texture.getSize()) {
+                sf::Image cropped(tileSize);
+                if (!cropped.copy(image, {0, 0}, {{0, 0}, sf::Vector2i(tileSize)}))
+                    throw std::runtime_error("Failed to crop export tile");
+                image = std::move(cropped);
+            }
+            auto tilePath = path;
+            if (tileCount > 1) {
+                tilePath.replace_filename(path.stem().string() + "_" + std::to_string(row) + "_" +
+                                          std::to_string(col) + path.extension().string());
+            }
+            if (!image.saveToFile(tilePath))
+                throw std::runtime_error("Failed to save " + tilePath.string());
+            written.push_back(tilePath);
+        }
+    }
+    return written;
+}
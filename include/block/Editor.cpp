@@ -5,18 +5,18 @@
 #include "Editor.hpp"
 
 // checks if pos is a legal final target for conccection
-bool Editor::isPosLegalEnd(const sf::Vector2i& end) const {
+bool Editor::isPosLegalEnd(const Vec2i& end) {
     if (conStartPos == end) return true; // no-op case
-    auto obj = block.whatIsAtCoord(end);
+    auto obj = whatIsAtCoord(end);
     if (!isCoordConType(obj)) {
-        ImGui::SetTooltip("Target obj invalid");
+        setTooltip("Target obj invalid");
         return false;
     }
     if (typeOf(obj) == ObjAtCoordType::Node) {
         auto node    = std::get<Ref<Node>>(obj);
         auto portNum = static_cast<std::size_t>(vecToDir(conStartPos - end));
         if (block.contains(PortRef{node, portNum})) {
-            ImGui::SetTooltip("Node already has connection in this direction");
+            setTooltip("Node already has connection in this direction");
             return false;
         }
     }
@@ -25,37 +25,34 @@ bool Editor::isPosLegalEnd(const sf::Vector2i& end) const {
         auto conDir  = block.getPort(con.portRef1).portDir;
         auto propDir = vecToDir(end - conStartPos);
         if (propDir == conDir || propDir == reverseDir(conDir)) {
-            ImGui::SetTooltip("Illegal connection overlap");
+            setTooltip("Illegal connection overlap");
             return false;
         }
     }
-    for (const auto& node: block.nodes) {
-        auto pos = node.obj.pos;
-        if (isVecBetween(pos, conStartPos, end)) {
-            ImGui::SetTooltip("Illegal connection overlap");
-            return false;
-        }
+    if (!block.nodesBetween(conStartPos, end).empty()) {
+        setTooltip("Illegal connection overlap");
+        return false;
     }
     return true;
 }
 
-bool Editor::isPosLegalStart(const sf::Vector2i& start) const {
-    auto obj = block.whatIsAtCoord(start);
+bool Editor::isPosLegalStart(const Vec2i& start) {
+    auto obj = whatIsAtCoord(start);
     if (!(isCoordConType(obj) || typeOf(conStartObjVar) == ObjAtCoordType::ConCross)) {
-        ImGui::SetTooltip("Target obj invalid");
+        setTooltip("Target obj invalid");
         return false;
     }
     if (typeOf(obj) == ObjAtCoordType::Node &&
         block.getNodeConCount(std::get<Ref<Node>>(obj)) == 4) {
-        ImGui::SetTooltip("Node already has 4 connections");
+        setTooltip("Node already has 4 connections");
         return false;
     }
     return true;
 }
 
-std::vector<sf::Vector2i> Editor::getOverlapPos(std::pair<sf::Vector2i, sf::Vector2i> line,
-                                                Ref<ClosedNet> netRef) const {
-    std::vector<sf::Vector2i> pos{};
+std::vector<Vec2i> Editor::getOverlapPos(std::pair<Vec2i, Vec2i> line,
+                                         Ref<ClosedNet>          netRef) const {
+    std::vector<Vec2i> pos{};
     for (const auto& netCon: block.nets[netRef]) {
         auto intersec = getLineIntersection(
             line, {block.getPort(netCon.portRef1).portPos, block.getPort(netCon.portRef2).portPos});
@@ -64,14 +61,17 @@ std::vector<sf::Vector2i> Editor::getOverlapPos(std::pair<sf::Vector2i, sf::Vect
     return pos;
 }
 
-std::vector<sf::Vector2i> Editor::getOverlapPos(Ref<ClosedNet> net1, Ref<ClosedNet> net2) const {
-    std::vector<sf::Vector2i> pos{};
-    for (const auto& con1: block.nets[net1]) {
-        auto con1Pos = getOverlapPos(
-            {block.getPort(con1.portRef1).portPos, block.getPort(con1.portRef2).portPos}, net2);
-        for (const auto& intersecPos: con1Pos) pos.emplace_back(intersecPos);
-    }
-    return pos;
+std::vector<Vec2i> Editor::getOverlapPos(Ref<ClosedNet> net1, Ref<ClosedNet> net2) const {
+    auto netLines = [&](Ref<ClosedNet> netRef) {
+        std::vector<std::pair<Vec2i, Vec2i>> lines{};
+        lines.reserve(block.nets[netRef].getSize());
+        for (const auto& con: block.nets[netRef]) {
+            lines.emplace_back(block.getPort(con.portRef1).portPos,
+                               block.getPort(con.portRef2).portPos);
+        }
+        return lines;
+    };
+    return getLineIntersections(netLines(net1), netLines(net2));
 }
 
 void Editor::updateOverlaps() {
@@ -79,7 +79,7 @@ void Editor::updateOverlaps() {
     if (conStartPos != conEndPos) {
         if (conStartCloNet && conEndCloNet) {
             if (conStartCloNet.value() == conEndCloNet.value()) {
-                ImGui::SetTooltip("Connection proposes loop"); // recomendation
+                setTooltip("Connection proposes loop"); // recomendation
             } else {
                 overlapPos = getOverlapPos(conStartCloNet.value(), conEndCloNet.value());
             }
@@ -98,13 +98,14 @@ void Editor::updateOverlaps() {
 }
 
 void Editor::resetToIdle() {
+    hoverKey.reset();
     conEndCloNet.reset();
     conStartCloNet.reset();
     overlapPos.clear();
     state = EditorState::Idle;
 }
 
-sf::Vector2i Editor::snapToGrid(const sf::Vector2f& pos) const {
+Vec2i Editor::snapToGrid(const sf::Vector2f& pos) const {
     return {std::clamp(static_cast<int>(std::round(pos.x)), 0, static_cast<int>(block.size - 1)),
             std::clamp(static_cast<int>(std::round(pos.y)), 0, static_cast<int>(block.size - 1))};
 }
@@ -184,28 +185,43 @@ void Editor::event(const sf::Event& event) {
 // Called every frame
 // Responsible for ensuring correct state of "con" variables according to block state and inputs
 void Editor::frame(const sf::Vector2f& mouseWorldPos) {
+    PROFILE_FUNCTION();
     auto mousePos = snapToGrid(mouseWorldPos);
+    // Idle and Connecting only depend on the snapped coord, so reuse last frame's results if the
+    // coord, state and block are all unchanged. Deleting also depends on the sub-coord position
+    if (state != EditorState::Deleting) {
+        HoverKey key{mousePos, state == EditorState::Connecting ? conStartPos : mousePos, state,
+                     block.getGeneration()};
+        if (hoverKey == key) {
+            if (tooltip) ImGui::SetTooltip("%s", tooltip);
+            return;
+        }
+        hoverKey = key;
+    } else {
+        hoverKey.reset();
+    }
+    tooltip = nullptr;
     overlapPos.clear();
     conEndCloNet.reset();
     switch (state) {
     case EditorState::Idle: {
         conStartPos    = mousePos;
-        conStartObjVar = block.whatIsAtCoord(conStartPos);
+        conStartObjVar = whatIsAtCoord(conStartPos);
         conStartLegal  = isPosLegalStart(conStartPos);
         // if network component find network
         switch (typeOf(conStartObjVar)) { // TODO maybe make own function
         case ObjAtCoordType::Node: {
-            conStartCloNet = block.getClosNetRef(std::get<Ref<Node>>(conStartObjVar));
+            conStartCloNet = getClosNetRef(std::get<Ref<Node>>(conStartObjVar));
             break;
         }
         case ObjAtCoordType::Con: {
-            conStartCloNet = block.getClosNetRef(std::get<Connection>(conStartObjVar).portRef1);
+            conStartCloNet = getClosNetRef(std::get<Connection>(conStartObjVar).portRef1);
             break;
         }
         case ObjAtCoordType::ConCross: {
             auto conPair   = std::get<std::pair<Connection, Connection>>(conStartObjVar);
-            conStartCloNet = block.getClosNetRef(conPair.first.portRef1);
-            conEndCloNet   = block.getClosNetRef(conPair.second.portRef1);
+            conStartCloNet = getClosNetRef(conPair.first.portRef1);
+            conEndCloNet   = getClosNetRef(conPair.second.portRef1);
             overlapPos     = getOverlapPos(conStartCloNet.value(), conEndCloNet.value());
             overlapPos.erase(std::remove(overlapPos.begin(), overlapPos.end(), conStartPos));
             break;
@@ -216,8 +232,8 @@ void Editor::frame(const sf::Vector2f& mouseWorldPos) {
         break;
     }
     case EditorState::Connecting: {
-        sf::Vector2i diff       = mousePos - conStartPos;
-        sf::Vector2i newEndProp = conStartPos + snapToAxis(diff); // default
+        Vec2i diff       = mousePos - conStartPos;
+        Vec2i newEndProp = conStartPos + snapToAxis(diff); // default
 
         // work out proposed end point based on state
         switch (typeOf(conStartObjVar)) { // from 1, up to dot(diff, portDir)
@@ -229,19 +245,17 @@ void Editor::frame(const sf::Vector2f& mouseWorldPos) {
         }
         case ObjAtCoordType::Node: { // finds best available direction
             // TODO maybe should just be handled by legal check
-            const auto& nodeRef  = std::get<Ref<Node>>(conStartObjVar);
-            const auto& node     = block.nodes[nodeRef];
-            auto        bestPort = std::max_element(
-                node.ports.begin(), node.ports.end(), [&](const auto& max, const auto& elem) {
+            const auto& nodeRef = std::get<Ref<Node>>(conStartObjVar);
+            auto        bestDir = *std::max_element(
+                Node::portDirs.begin(), Node::portDirs.end(), [&](Direction max, Direction elem) {
                     bool isElemPortInUse =
-                        block.contains(PortRef(nodeRef, static_cast<std::size_t>(elem.portDir)));
+                        block.contains(PortRef(nodeRef, static_cast<std::size_t>(elem)));
                     bool isMaxPortInUse =
-                        block.contains(PortRef(nodeRef, static_cast<std::size_t>(max.portDir)));
-                    return isMaxPortInUse ||
-                           (dot(max.portDir, diff) < dot(elem.portDir, diff) && !isElemPortInUse);
+                        block.contains(PortRef(nodeRef, static_cast<std::size_t>(max)));
+                    return isMaxPortInUse || (dot(max, diff) < dot(elem, diff) && !isElemPortInUse);
                 });
-            int bestDist = std::clamp(dot(bestPort->portDir, diff), 0, INT_MAX);
-            newEndProp   = conStartPos + (dirToVec(bestPort->portDir) * bestDist);
+            int bestDist = std::clamp(dot(bestDir, diff), 0, INT_MAX);
+            newEndProp   = conStartPos + (dirToVec(bestDir) * bestDist);
             break;
         }
         case ObjAtCoordType::Con: {
@@ -267,14 +281,14 @@ void Editor::frame(const sf::Vector2f& mouseWorldPos) {
         }
         conEndLegal  = true;
         conEndPos    = newEndProp;
-        conEndObjVar = block.whatIsAtCoord(conEndPos);
+        conEndObjVar = whatIsAtCoord(conEndPos);
         switch (typeOf(conEndObjVar)) { // if network component find closednet
         case ObjAtCoordType::Node: {
-            conEndCloNet = block.getClosNetRef(std::get<Ref<Node>>(conEndObjVar));
+            conEndCloNet = getClosNetRef(std::get<Ref<Node>>(conEndObjVar));
             break;
         }
         case ObjAtCoordType::Con: {
-            conEndCloNet = block.getClosNetRef(std::get<Connection>(conEndObjVar).portRef1);
+            conEndCloNet = getClosNetRef(std::get<Connection>(conEndObjVar).portRef1);
             break;
         }
         default:
@@ -284,15 +298,15 @@ void Editor::frame(const sf::Vector2f& mouseWorldPos) {
         break;
     }
     case EditorState::Deleting: {
-        ImGui::SetTooltip("Deleting");
-        delObjVar             = block.whatIsAtCoord(mousePos);
-        auto worldGridPosDiff = mouseWorldPos - sf::Vector2f(mousePos);
+        setTooltip("Deleting");
+        delObjVar             = whatIsAtCoord(mousePos);
+        auto worldGridPosDiff = fromSf(mouseWorldPos) - Vec2f(mousePos);
         if (typeOf(delObjVar) == ObjAtCoordType::Node &&
             mag(worldGridPosDiff) > 0.25f) { // del con over node if far away
             auto node = std::get<Ref<Node>>(delObjVar);
             auto dir  = vecToDir(snapToAxis(worldGridPosDiff));
             auto port = PortRef{node, static_cast<std::size_t>(dir)};
-            auto con  = block.getClosNetRef(port);
+            auto con  = getClosNetRef(port);
             if (con) { // if connection to snap to
                 delObjVar = block.nets[con.value()].getCon(port);
             }
@@ -305,9 +319,10 @@ void Editor::frame(const sf::Vector2f& mouseWorldPos) {
             delLegal = true;
             break;
         default:
-            ImGui::SetTooltip("Delete not yet implemented for this object");
+            setTooltip("Delete not yet implemented for this object");
             break;
         }
     }
     }
+    if (tooltip) ImGui::SetTooltip("%s", tooltip);
 }
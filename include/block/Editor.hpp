@@ -3,18 +3,31 @@
 #include <SFML/Window/Event.hpp>
 
 #include "Block.hpp"
+#include "SfmlVec2.hpp"
+#include "details/Profiler.hpp"
 
 // Editor is responsible for storing and updating the state of the editor gui
 class Editor {
   private:
-    bool isPosLegalEnd(const sf::Vector2i& pos) const;
-    bool isPosLegalStart(const sf::Vector2i& start) const;
-    [[nodiscard]] std::vector<sf::Vector2i>
-    getOverlapPos(std::pair<sf::Vector2i, sf::Vector2i> line, Ref<ClosedNet> netRef) const;
-    [[nodiscard]] std::vector<sf::Vector2i> getOverlapPos(Ref<ClosedNet> net1,
-                                                          Ref<ClosedNet> net2) const;
-    void                                    updateOverlaps();
-    void                                    resetToIdle();
+    void setTooltip(const char* text) { tooltip = text; }
+    bool isPosLegalEnd(const Vec2i& pos);
+    bool isPosLegalStart(const Vec2i& start);
+    [[nodiscard]] std::vector<Vec2i> getOverlapPos(std::pair<Vec2i, Vec2i> line,
+                                                   Ref<ClosedNet>          netRef) const;
+    [[nodiscard]] std::vector<Vec2i> getOverlapPos(Ref<ClosedNet> net1, Ref<ClosedNet> net2) const;
+    void                             updateOverlaps();
+    void                             resetToIdle();
+
+    // block lookups go through these so the Debug window can show how many each frame makes
+    [[nodiscard]] ObjAtCoord whatIsAtCoord(const Vec2i& pos) const {
+        PROFILE_COUNT("whatIsAtCoord");
+        return block.whatIsAtCoord(pos);
+    }
+    template <typename Obj>
+    [[nodiscard]] std::optional<Ref<ClosedNet>> getClosNetRef(const Obj& obj) const {
+        PROFILE_COUNT("getClosNetRef");
+        return block.getClosNetRef(obj);
+    }
 
   public:
     Editor(Block& block_) : block(block_) {}
@@ -24,8 +37,8 @@ class Editor {
 
     Block& block;
 
-    sf::Vector2i                  conStartPos;
-    sf::Vector2i                  conEndPos;
+    Vec2i                         conStartPos;
+    Vec2i                         conEndPos;
     ObjAtCoord                    conStartObjVar;
     ObjAtCoord                    conEndObjVar;
     std::optional<Ref<ClosedNet>> conStartCloNet;
@@ -33,12 +46,24 @@ class Editor {
     bool                          conStartLegal;
     bool                          conEndLegal;
 
-    std::vector<sf::Vector2i> overlapPos;
+    std::vector<Vec2i> overlapPos;
 
     ObjAtCoord delObjVar;
     bool       delLegal;
 
-    sf::Vector2i snapToGrid(const sf::Vector2f& pos) const; // should be in block
-    void         event(const sf::Event& event);
-    void         frame(const sf::Vector2f& mouseWorldPos);
+    Vec2i snapToGrid(const sf::Vector2f& pos) const; // should be in block
+    void  event(const sf::Event& event);
+    void  frame(const sf::Vector2f& mouseWorldPos);
+
+  private:
+    // inputs the hover results in frame() depend on, see frame()
+    struct HoverKey {
+        Vec2i         mousePos;
+        Vec2i         startPos;
+        EditorState   state;
+        std::uint64_t generation;
+        bool          operator==(const HoverKey&) const = default;
+    };
+    std::optional<HoverKey> hoverKey;
+    const char*             tooltip = nullptr; // shown every frame, whether recomputed or not
 };
\ No newline at end of file
@@ -1,15 +1,22 @@
 #pragma once
 
 #include <SFML/Window/Mouse.hpp>
+#include <cfloat>
 #include <cmath>
 
-#include <SFML/Graphics/CircleShape.hpp>
+#include <SFML/Graphics/RenderTexture.hpp>
 #include <SFML/Graphics/RenderWindow.hpp>
+#include <SFML/Graphics/Sprite.hpp>
 #include <SFML/Graphics/Text.hpp>
 #include <imgui.h>
+#include <limits>
 #include <stdexcept>
 
+#include "absl/container/node_hash_map.h"
+
+#include "BlockRenderer.hpp"
 #include "Editor.hpp"
+#include "details/Profiler.hpp"
 
 // editor renderer contains const& to editor and is only responsible for displaying its internal
 // state
@@ -19,12 +26,9 @@ class EditorRenderer {
     float     zoomFact        = 1.05f;
     float     nameScale       = 1.5f;
     float     crossSize       = 0.1f;
-    float     nodeRad         = 0.1f;
     float     newNodeScale    = 1.5f;
     sf::Color gridColour{255, 255, 255, 70};
     sf::Color cursorPointColour{255, 255, 255, 100};
-    sf::Color nodeColour   = sf::Color::White;
-    sf::Color conColour    = sf::Color::White;
     sf::Color newConColour = sf::Color::Green;
     sf::Color overlapColour{255, 102, 0, 150};
     sf::Color highlightConColour = {102, 255, 255, 255};
@@ -40,8 +44,47 @@ class EditorRenderer {
     sf::View          view;
     sf::Vector2u      prevWindowSize;
 
+    BlockRenderer           blockRend; // wires and junctions, cached per net and per chunk
+    std::vector<sf::Vertex> overVerts;   // nets highlighted over the cached geometry
+    std::vector<sf::Vertex> markerVerts; // cursor, overlap and debug nodes, rebuilt every frame
+
+    // level of detail, below lodPixPerCoord wires and junctions are drawn from cached textures
+    // a level l tile covers (tileCoords << l) square coords at tilePixels square resolution, so
+    // each level halves the resolution of the one before
+    struct TileKey {
+        int          level = 0;
+        sf::Vector2i index;
+        bool         operator==(const TileKey&) const = default;
+        template <typename H>
+        friend H AbslHashValue(H h, const TileKey& key) {
+            return H::combine(std::move(h), key.level, key.index.x, key.index.y);
+        }
+    };
+    struct Tile {
+        sf::RenderTexture texture;
+        bool              dirty    = true;
+        std::uint64_t     lastUsed = 0; // frame number
+    };
+    static constexpr int      tileCoords     = 64;
+    static constexpr unsigned tilePixels     = 256;
+    static constexpr float    lodPixPerCoord = tilePixels / static_cast<float>(tileCoords);
+    bool                      lodEnabled     = true;
+    std::size_t               maxTiles       = 256; // least recently used are dropped beyond this
+
+    absl::node_hash_map<TileKey, Tile> tiles;
+    std::uint64_t                      frameCount = 0;
+
+    // grid is only built for the visible coords, with spacing doubled until crosses are at least
+    // minGridSpacing pixels apart
+    struct GridRange {
+        sf::Vector2i min;
+        sf::Vector2i max;
+        int          step = 0;
+        bool         operator==(const GridRange&) const = default;
+    };
+    float                     minGridSpacing = 12.0f;
+    GridRange                 gridRange;
     std::vector<sf::Vertex>   gridVerts;
-    std::array<sf::Vertex, 5> borderVerts;
     sf::Text                  name;
 
     enum struct MoveStatus : std::size_t { idle = 0, moveStarted = 1, moveConfirmed = 2 };
@@ -54,13 +97,14 @@ class EditorRenderer {
     std::optional<Ref<Node>>                    debugNode;
     std::optional<Connection>                   debugCon;
     std::optional<Ref<ClosedNet>>               debugNet;
+    std::vector<float>                          plotBuffer;
 
     static std::string portRefToString(const PortRef& port) {
-        std::string portName = PortObjRefStrings[port.ref.index()] + " ";
+        std::string portName = PortObjRefStrings[port.ref().index()] + " ";
         if (typeOf(port) == PortObjType::Node) {
-            portName += DirectionStrings[port.portNum];
+            portName += DirectionStrings[port.portNum()];
         } else {
-            portName += std::to_string(port.portNum);
+            portName += std::to_string(port.portNum());
         }
         return portName;
     }
@@ -76,17 +120,46 @@ class EditorRenderer {
         prevWindowSize = window.getSize();
     }
 
+    [[nodiscard]] sf::FloatRect viewRect() const {
+        return {view.getCenter() - view.getSize() / 2.0f, view.getSize()};
+    }
+
+    [[nodiscard]] float pixPerCoord() const {
+        return static_cast<float>(window.getSize().x) / view.getSize().x;
+    }
+
+    // rebuilds the grid if the visible range or zoom level has changed since last time
     void updateGrid() {
+        auto  visible     = viewRect();
+        int   step        = 1;
+        while (static_cast<float>(step) * pixPerCoord() < minGridSpacing &&
+               step < static_cast<int>(block.size))
+            step *= 2;
+        // first visible multiple of step and last visible coord, clamped to the block
+        auto lower = [&](float coord) {
+            auto firstStep = static_cast<int>(std::floor(coord / static_cast<float>(step)));
+            return std::max(0, firstStep * step);
+        };
+        auto upper = [&](float coord) {
+            return std::min(static_cast<int>(block.size) - 1, static_cast<int>(std::ceil(coord)));
+        };
+        GridRange range{{lower(visible.position.x), lower(visible.position.y)},
+                        {upper(visible.position.x + visible.size.x),
+                         upper(visible.position.y + visible.size.y)},
+                        step};
+        if (range == gridRange) return;
+        gridRange = range;
+
         gridVerts.clear();
-        gridVerts.reserve(block.size * block.size * (isGridCrosses ? 4 : 1));
-        for (std::size_t x = 0; x < block.size; ++x) {
-            for (std::size_t y = 0; y < block.size; ++y) {
+        float crossLen = crossSize * static_cast<float>(step);
+        for (int x = range.min.x; x <= range.max.x; x += step) {
+            for (int y = range.min.y; y <= range.max.y; y += step) {
                 sf::Vector2f pos{static_cast<float>(x), static_cast<float>(y)};
                 if (isGridCrosses) {
-                    gridVerts.emplace_back(pos - sf::Vector2f{-crossSize, 0.0f}, gridColour);
-                    gridVerts.emplace_back(pos - sf::Vector2f{crossSize, 0.0f}, gridColour);
-                    gridVerts.emplace_back(pos - sf::Vector2f{0.0f, -crossSize}, gridColour);
-                    gridVerts.emplace_back(pos - sf::Vector2f{0.0f, crossSize}, gridColour);
+                    gridVerts.emplace_back(pos - sf::Vector2f{-crossLen, 0.0f}, gridColour);
+                    gridVerts.emplace_back(pos - sf::Vector2f{crossLen, 0.0f}, gridColour);
+                    gridVerts.emplace_back(pos - sf::Vector2f{0.0f, -crossLen}, gridColour);
+                    gridVerts.emplace_back(pos - sf::Vector2f{0.0f, crossLen}, gridColour);
                 } else {
                     gridVerts.emplace_back(pos, gridColour);
                 }
@@ -94,20 +167,18 @@ class EditorRenderer {
         }
     }
 
+    // what the last drawn frame showed, to tell if another is needed
+    std::uint64_t drawnGeneration = std::numeric_limits<std::uint64_t>::max();
+    sf::Vector2f  drawnViewCentre;
+    sf::Vector2f  drawnViewSize;
+
   public:
+    // redraw every frame rather than only when something changes, eg. for simulation playback
+    bool continuousRedraw = false;
+
     EditorRenderer(const Editor& editor_, sf::RenderWindow& window_, const sf::Font& font_)
         : font(font_), editor(editor_), block(editor.block), window(window_),
-          name(font, block.name) {
-        // make grid
-        updateGrid();
-
-        // make border
-        borderVerts[0] = {{-1.0f, -1.0f}};
-        borderVerts[1] = {{-1.0f, static_cast<float>(block.size)}};
-        borderVerts[2] = {{static_cast<float>(block.size), static_cast<float>(block.size)}};
-        borderVerts[3] = {{static_cast<float>(block.size), -1.0f}};
-        borderVerts[4] = {{-1.0f, -1.0f}};
-
+          blockRend(block), name(font, block.name) {
         // set up name
         name.setScale(sf::Vector2f{1.0f, 1.0f} *
                       (nameScale / static_cast<float>(name.getCharacterSize())));
@@ -156,6 +227,12 @@ class EditorRenderer {
         return false;
     }
 
+    // true if the block or view has changed since the last drawn frame
+    [[nodiscard]] bool hasChanged() const {
+        return block.getGeneration() != drawnGeneration || view.getCenter() != drawnViewCentre ||
+               view.getSize() != drawnViewSize;
+    }
+
     // called every visual frame
     void frame(const sf::Vector2i& mousePixPos) {
         sf::Vector2f mousePos = window.mapPixelToCoords(mousePixPos);
@@ -164,7 +241,8 @@ class EditorRenderer {
                 ImGui::SetMouseCursor(ImGuiMouseCursor_ResizeAll);
             view.move(mousePosLast - mousePos); // moves grabbed point underneath cursor
             window.setView(view);
-            if (mag(mousePixPos - mousePosOriginal) / static_cast<float>(window.getSize().x) >
+            if (mag(fromSf(mousePixPos - mousePosOriginal)) /
+                    static_cast<float>(window.getSize().x) >
                 0.03f)
                 moveStatus = MoveStatus::moveConfirmed;
         }
@@ -179,19 +257,299 @@ class EditorRenderer {
     }
 
   private:
-    void drawNode(const sf::Vector2i& pos, float radius, const sf::Color& col) {
-        sf::CircleShape circ{radius};
-        circ.setFillColor(col);
-        circ.setPosition(sf::Vector2f(pos) - (sf::Vector2f(radius, radius)));
-        window.draw(circ);
+    // queues a marker, all markers are drawn together at the end of draw()
+    void drawNode(const Vec2i& pos, float radius, const sf::Color& col) {
+        BlockRenderer::appendCircle(markerVerts, pos, radius, col);
     }
 
-    void drawSingleLine(std::vector<sf::Vertex>& vertVec, const sf::Vector2i& pos1,
-                        const sf::Vector2i& pos2, const sf::Color& col) {
-        vertVec.emplace_back(sf::Vector2f{pos1}, col);
-        vertVec.emplace_back(sf::Vector2f{pos2}, col);
+    [[nodiscard]] static sf::FloatRect tileBounds(const TileKey& key) {
+        auto size = static_cast<float>(tileCoords << key.level);
+        return {sf::Vector2f(key.index) * size, {size, size}};
     }
 
+    void invalidateTiles(const sf::FloatRect& area) {
+        for (auto& [key, tile]: tiles) {
+            if (overlaps(tileBounds(key), area)) tile.dirty = true;
+        }
+    }
+
+    // coarsest level whose resolution is still at least that of the screen
+    [[nodiscard]] int lodLevel() const {
+        int level = 0;
+        while (lodPixPerCoord / static_cast<float>(2 << level) >= pixPerCoord() &&
+               (tileCoords << level) < static_cast<int>(block.size))
+            ++level;
+        return level;
+    }
+
+    // composites the tiles covering area, rendering any that are missing or dirty first
+    void drawTiles(const sf::FloatRect& area) {
+        PROFILE_SCOPE("drawTiles");
+        ++frameCount;
+        int  level    = lodLevel();
+        auto size     = static_cast<float>(tileCoords << level);
+        auto tileOf   = [&](float coord) { return static_cast<int>(std::floor(coord / size)); };
+        auto minIndex = sf::Vector2i{tileOf(area.position.x), tileOf(area.position.y)};
+        auto maxIndex = sf::Vector2i{tileOf(area.position.x + area.size.x),
+                                     tileOf(area.position.y + area.size.y)};
+        auto blockArea = blockRend.blockArea(); // nothing to draw outside the block
+        for (int x = minIndex.x; x <= maxIndex.x; ++x) {
+            for (int y = minIndex.y; y <= maxIndex.y; ++y) {
+                TileKey key{level, {x, y}};
+                auto    bounds = tileBounds(key);
+                if (!overlaps(bounds, blockArea)) continue;
+                auto [it, inserted] = tiles.try_emplace(key);
+                auto& tile          = it->second;
+                if (inserted && !tile.texture.resize({tilePixels, tilePixels}))
+                    throw std::runtime_error("Failed to create LOD tile texture");
+                if (tile.dirty) {
+                    tile.texture.setSmooth(true);
+                    tile.texture.clear(sf::Color::Transparent);
+                    tile.texture.setView(sf::View(bounds));
+                    blockRend.draw(tile.texture, bounds);
+                    tile.texture.display();
+                    tile.dirty = false;
+                }
+                tile.lastUsed = frameCount;
+                sf::Sprite sprite(tile.texture.getTexture());
+                sprite.setPosition(bounds.position);
+                sprite.setScale(sf::Vector2f{1.0f, 1.0f} * (size / static_cast<float>(tilePixels)));
+                window.draw(sprite);
+            }
+        }
+        evictTiles();
+    }
+
+    // drops least recently used tiles beyond maxTiles, never ones used this frame
+    void evictTiles() {
+        if (tiles.size() <= maxTiles) return;
+        std::vector<std::pair<std::uint64_t, TileKey>> byAge;
+        byAge.reserve(tiles.size());
+        for (const auto& [key, tile]: tiles) byAge.emplace_back(tile.lastUsed, key);
+        auto excess = static_cast<std::ptrdiff_t>(tiles.size() - maxTiles);
+        std::nth_element(byAge.begin(), byAge.begin() + excess, byAge.end(),
+                         [](const auto& a, const auto& b) { return a.first < b.first; });
+        for (auto it = byAge.begin(); it != byAge.begin() + excess; ++it) {
+            if (it->first != frameCount) tiles.erase(it->second);
+        }
+    }
+
+    // draws one net's connections in col on top of the cached geometry
+    void drawNetOver(Ref<ClosedNet> netRef, const sf::Color& col) {
+        if (!block.nets.contains(netRef)) return;
+        blockRend.buildNetVerts(block.nets[netRef], col, overVerts);
+        window.draw(overVerts.data(), overVerts.size(), sf::PrimitiveType::Lines);
+    }
+
+    void drawSingleLine(std::vector<sf::Vertex>& vertVec, const Vec2i& pos1, const Vec2i& pos2,
+                        const sf::Color& col) {
+        vertVec.emplace_back(sf::Vector2f{toSf(pos1)}, col);
+        vertVec.emplace_back(sf::Vector2f{toSf(pos2)}, col);
+    }
+
+    // rows of the Debug networks table, nets are laid out as consecutive rows so only the visible
+    // ones need to be touched. Labels are cached per net until its generation changes
+    struct NetLabels {
+        std::uint64_t                                    generation = 0;
+        std::string                                      input;
+        std::vector<std::string>                         outputs;
+        std::vector<Connection>                          cons;
+        std::vector<std::pair<std::string, std::string>> conPorts;
+    };
+    absl::node_hash_map<Ref<ClosedNet>, NetLabels>      netLabels;
+    absl::flat_hash_set<Ref<ClosedNet>>                 collapsedNets;
+    std::vector<std::pair<std::size_t, Ref<ClosedNet>>> netRowStarts; // first row of each net
+    std::size_t                                         netRowCount  = 0;
+    bool                                                netRowsDirty = true;
+
+    std::uint64_t netRowsGeneration = std::numeric_limits<std::uint64_t>::max();
+
+    const NetLabels& getNetLabels(Ref<ClosedNet> netRef) {
+        auto  generation = block.getNetGeneration(netRef);
+        auto& labels     = netLabels[netRef];
+        if (labels.generation == generation) return labels;
+        labels.generation = generation;
+        const auto& net   = block.nets[netRef];
+        labels.input =
+            net.hasInput() ? PortObjRefStrings[net.getInput()->ref().index()] : std::string{};
+        labels.outputs.clear();
+        for (const auto& output: net.getOutputs()) {
+            labels.outputs.push_back(PortObjRefStrings[output.ref().index()]);
+        }
+        labels.cons.clear();
+        labels.conPorts.clear();
+        for (const auto& con: net) {
+            labels.cons.push_back(con);
+            labels.conPorts.emplace_back(portRefToString(con.portRef1),
+                                         portRefToString(con.portRef2));
+        }
+        return labels;
+    }
+
+    // works out which rows each net occupies, only when nets or their collapsed state change
+    void layoutNetRows() {
+        if (!netRowsDirty && block.getGeneration() == netRowsGeneration) return;
+        absl::erase_if(netLabels,
+                       [&](const auto& entry) { return !block.nets.contains(entry.first); });
+        absl::erase_if(collapsedNets, [&](const auto& net) { return !block.nets.contains(net); });
+        netRowStarts.clear();
+        netRowCount = 0;
+        for (const auto& net: block.nets) {
+            netRowStarts.emplace_back(netRowCount, net.ind);
+            netRowCount += collapsedNets.contains(net.ind)
+                               ? 1
+                               : std::max({std::size_t{1}, net.obj.getSize(),
+                                           net.obj.getOutputs().size()});
+        }
+        netRowsGeneration = block.getGeneration();
+        netRowsDirty      = false;
+    }
+
+    void conPortSelectable(const std::string& label, const PortRef& port, const Connection& con,
+                           bool netHovered, const ImVec2& size) {
+        ImGui::Selectable(label.c_str(), netHovered, 0, size);
+        if (ImGui::IsItemHovered() && typeOf(port) == PortObjType::Node) {
+            debugNode = std::get<Ref<Node>>(port.ref());
+            debugCon  = con;
+            ImGui::SetTooltip("Debug node and con");
+        }
+    }
+
+    // draws one row of the networks table
+    void netRow(std::size_t row) {
+        auto start = std::upper_bound(
+            netRowStarts.begin(), netRowStarts.end(), row,
+            [](std::size_t r, const auto& netStart) { return r < netStart.first; });
+        --start;
+        auto        netIndex  = static_cast<std::size_t>(start - netRowStarts.begin());
+        auto        netRef    = start->second;
+        std::size_t netRowNum = row - start->first;
+        bool        collapsed = collapsedNets.contains(netRef);
+
+        ImGui::TableNextRow();
+        ImGui::PushID(static_cast<int>(row));
+        ImGui::TableSetColumnIndex(0);
+        if (netRowNum == 0) {
+            ImGui::SetNextItemOpen(!collapsed);
+            bool netOpen = ImGui::TreeNodeEx("",
+                                             ImGuiTreeNodeFlags_AllowItemOverlap |
+                                                 ImGuiTreeNodeFlags_SpanAvailWidth |
+                                                 ImGuiTreeNodeFlags_NoTreePushOnOpen,
+                                             "Net %zu", netIndex + 1);
+            if (ImGui::IsItemHovered()) {
+                debugNet = netRef;
+                ImGui::SetTooltip("Debug net");
+            }
+            if (netOpen == collapsed) { // toggled, takes effect next frame
+                if (netOpen) {
+                    collapsedNets.erase(netRef);
+                } else {
+                    collapsedNets.insert(netRef);
+                }
+                netRowsDirty = true;
+            }
+        }
+        if (collapsed) {
+            for (int col = 1; col < 4; ++col) {
+                ImGui::TableSetColumnIndex(col);
+                ImGui::TextDisabled("...");
+            }
+            ImGui::PopID();
+            return;
+        }
+
+        const auto& labels     = getNetLabels(netRef);
+        bool        netHovered = debugNet && debugNet.value() == netRef;
+        if (netRowNum == 0) {
+            ImGui::TableSetColumnIndex(1);
+            if (!labels.input.empty()) {
+                ImGui::Selectable(labels.input.c_str());
+            } else {
+                ImGui::TextDisabled("none");
+            }
+            if (labels.outputs.empty()) {
+                ImGui::TableSetColumnIndex(2);
+                ImGui::TextDisabled("none");
+            }
+        }
+        if (netRowNum < labels.outputs.size()) {
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Selectable(labels.outputs[netRowNum].c_str());
+        }
+        if (netRowNum < labels.cons.size()) {
+            const auto& con   = labels.cons[netRowNum];
+            const auto& ports = labels.conPorts[netRowNum];
+            ImGui::TableSetColumnIndex(3);
+            conPortSelectable(ports.first, con.portRef1, con, netHovered,
+                              {ImGui::GetContentRegionAvail().x / 2.0f,
+                               ImGui::GetTextLineHeight()});
+            ImGui::SameLine();
+            conPortSelectable(ports.second, con.portRef2, con, netHovered, {});
+        }
+        ImGui::PopID();
+    }
+
+#ifdef TECHNO_LOGIC_PROFILING
+    // rolling percentiles over the last Profiler::historySize frames
+    void profilerDebug() {
+        auto& profiler = Profiler::get();
+        ImGui::Checkbox("Enabled", &profiler.enabled);
+        const auto& frameMillis = profiler.getFrameMillis();
+        frameMillis.linearise(plotBuffer);
+        ImGui::Text("Frame ms  p50 %.2f  p95 %.2f  p99 %.2f", frameMillis.percentile(0.5),
+                    frameMillis.percentile(0.95), frameMillis.percentile(0.99));
+        ImGui::PlotLines("##frame", plotBuffer.data(), static_cast<int>(plotBuffer.size()), 0,
+                         "frame time (ms)", 0.0f, FLT_MAX, {0, 80});
+        static ImGuiTableFlags flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                                       ImGuiTableFlags_SizingStretchSame;
+        if (ImGui::BeginTable("Sections", 5, flags)) {
+            ImGui::TableSetupColumn("Section");
+            ImGui::TableSetupColumn("p50 us");
+            ImGui::TableSetupColumn("p95 us");
+            ImGui::TableSetupColumn("p99 us");
+            ImGui::TableSetupColumn("calls");
+            ImGui::TableHeadersRow();
+            for (const auto& sec: profiler.getSections()) {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(sec.name.c_str());
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f", sec.micros.percentile(0.5));
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f", sec.micros.percentile(0.95));
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f", sec.micros.percentile(0.99));
+                ImGui::TableNextColumn();
+                ImGui::Text("%u", sec.calls.empty() ? 0U : sec.calls.back());
+            }
+            ImGui::EndTable();
+        }
+        // the editor's block lookups, counted per frame rather than timed
+        if (ImGui::BeginTable("Counters", 5, flags)) {
+            ImGui::TableSetupColumn("Lookup");
+            ImGui::TableSetupColumn("p50 calls");
+            ImGui::TableSetupColumn("p95 calls");
+            ImGui::TableSetupColumn("p99 calls");
+            ImGui::TableSetupColumn("last");
+            ImGui::TableHeadersRow();
+            for (const auto& counter: profiler.getCounters()) {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(counter.name.c_str());
+                ImGui::TableNextColumn();
+                ImGui::Text("%u", counter.counts.percentile(0.5));
+                ImGui::TableNextColumn();
+                ImGui::Text("%u", counter.counts.percentile(0.95));
+                ImGui::TableNextColumn();
+                ImGui::Text("%u", counter.counts.percentile(0.99));
+                ImGui::TableNextColumn();
+                ImGui::Text("%u", counter.counts.empty() ? 0U : counter.counts.back());
+            }
+            ImGui::EndTable();
+        }
+    }
+#endif
+
     void debug(const sf::Vector2f& mousePos) {
         auto mouseCoord = editor.snapToGrid(mousePos);
         ImGui::Begin("Debug", NULL);
@@ -202,8 +560,17 @@ class EditorRenderer {
             ImGui::Text("View size: (%F, %F)", view.getSize().x, view.getSize().y);
             ImGui::Text("Move status: %s",
                         MoveStatusStrings[static_cast<std::size_t>(moveStatus)].c_str());
+            ImGui::Checkbox("LOD tiles", &lodEnabled);
+            ImGui::Checkbox("Continuous redraw", &continuousRedraw);
+            ImGui::Text("Cached tiles: %zu, level %d", tiles.size(), lodLevel());
+            ImGui::TreePop();
+        }
+#ifdef TECHNO_LOGIC_PROFILING
+        if (ImGui::TreeNode("Profiler")) {
+            profilerDebug();
             ImGui::TreePop();
         }
+#endif
         if (ImGui::TreeNode("Current Connection")) {
             std::string startHover = ObjAtCoordStrings[editor.conStartObjVar.index()];
             switch (editor.state) {
@@ -233,92 +600,24 @@ class EditorRenderer {
             ImGui::Text("Node count: %zu", block.nodes.size());
             static ImGuiTableFlags flags =
                 ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
-                ImGuiTableFlags_SizingStretchSame |
-                ImGuiTableFlags_Resizable; // ImGuiTableFlags_NoHostExtendX |
-                                           // ImGuiTableFlags_SizingFixedFit
-            if (ImGui::BeginTable("Connections", 4, flags)) {
+                ImGuiTableFlags_SizingStretchSame | ImGuiTableFlags_Resizable |
+                ImGuiTableFlags_ScrollY; // ImGuiTableFlags_NoHostExtendX |
+                                         // ImGuiTableFlags_SizingFixedFit
+            layoutNetRows();
+            if (ImGui::BeginTable("Connections", 4, flags,
+                                  {0.0f, ImGui::GetTextLineHeightWithSpacing() * 25})) {
+                ImGui::TableSetupScrollFreeze(0, 1);
                 ImGui::TableSetupColumn("Network");
                 ImGui::TableSetupColumn("Input");
                 ImGui::TableSetupColumn("Output");
                 ImGui::TableSetupColumn("Connections");
                 ImGui::TableHeadersRow();
-                int netCount = 1;
-                for (const auto& net: block.nets) {
-                    ImGui::TableNextRow();
-                    ImGui::TableNextColumn();
-                    ImGui::PushID(netCount);
-                    bool netOpen         = ImGui::TreeNodeEx("",
-                                                             ImGuiTreeNodeFlags_DefaultOpen |
-                                                                 ImGuiTreeNodeFlags_AllowItemOverlap |
-                                                                 ImGuiTreeNodeFlags_SpanAvailWidth,
-                                                             "Net %d", netCount);
-                    bool debugNetHovered = false;
-                    if (ImGui::IsItemHovered()) {
-                        debugNet        = net.ind;
-                        debugNetHovered = true;
-                        ImGui::SetTooltip("Debug net");
+                ImGuiListClipper clipper;
+                clipper.Begin(static_cast<int>(netRowCount));
+                while (clipper.Step()) {
+                    for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+                        netRow(static_cast<std::size_t>(row));
                     }
-                    if (netOpen) {
-                        ImGui::TableSetColumnIndex(1);
-                        if (net.obj.hasInput()) {
-                            ImGui::Selectable(
-                                PortObjRefStrings[net.obj.getInput().value().ref.index()].c_str());
-                        } else {
-                            ImGui::TextDisabled("none");
-                        }
-                        const auto& outputs = net.obj.getOutputs();
-                        if (outputs.empty()) {
-                            ImGui::TableSetColumnIndex(2);
-                            ImGui::TextDisabled("none");
-                        }
-                        bool isFirst  = true;
-                        auto conIt    = net.obj.begin();
-                        auto outputIt = outputs.begin();
-                        while (conIt != net.obj.end() || outputIt != outputs.end()) {
-                            if (isFirst) {
-                                isFirst = false;
-                            } else {
-                                ImGui::TableNextRow();
-                            }
-                            if (outputIt != outputs.end()) {
-                                ImGui::TableSetColumnIndex(2);
-                                ImGui::Selectable(PortObjRefStrings[outputIt->ref.index()].c_str());
-                            }
-                            if (conIt != net.obj.end()) {
-                                ImGui::TableSetColumnIndex(3);
-                                ImGui::Selectable(portRefToString(conIt->portRef1).c_str(),
-                                                  debugNetHovered, 0,
-                                                  {ImGui::GetContentRegionAvail().x / 2.0f,
-                                                   ImGui::GetTextLineHeight()});
-                                if (ImGui::IsItemHovered() &&
-                                    typeOf(conIt->portRef1) == PortObjType::Node) {
-                                    debugNode = std::get<Ref<Node>>(conIt->portRef1.ref);
-                                    debugCon  = *conIt;
-                                    ImGui::SetTooltip("Debug node and con");
-                                }
-                                ImGui::SameLine();
-                                ImGui::Selectable(portRefToString(conIt->portRef2).c_str(),
-                                                  debugNetHovered);
-                                if (ImGui::IsItemHovered() &&
-                                    typeOf(conIt->portRef2) == PortObjType::Node) {
-                                    debugNode = std::get<Ref<Node>>(conIt->portRef2.ref);
-                                    debugCon  = *conIt;
-                                    ImGui::SetTooltip("Debug node and con");
-                                }
-                                ++conIt;
-                            }
-                        }
-                        ImGui::TreePop();
-                    } else {
-                        ImGui::TableNextColumn();
-                        ImGui::TextDisabled("...");
-                        ImGui::TableNextColumn();
-                        ImGui::TextDisabled("...");
-                        ImGui::TableNextColumn();
-                        ImGui::TextDisabled("...");
-                    }
-                    ImGui::PopID();
-                    ++netCount;
                 }
                 ImGui::EndTable();
             }
@@ -328,41 +627,37 @@ class EditorRenderer {
     }
 
     void draw(const sf::Vector2f& mousePos) {
-        sf::Vector2i mouseCoord = editor.snapToGrid(mousePos);
+        Vec2i mouseCoord = editor.snapToGrid(mousePos);
+
+        drawnGeneration = block.getGeneration();
+        drawnViewCentre = view.getCenter();
+        drawnViewSize   = view.getSize();
 
         // basics
+        auto visible = viewRect();
+        updateGrid();
         window.draw(name);
         window.draw(gridVerts.data(), gridVerts.size(),
                     isGridCrosses ? sf::PrimitiveType::Lines : sf::PrimitiveType::Points);
-        window.draw(borderVerts.data(), borderVerts.size(), sf::PrimitiveType::LineStrip);
-
-        // draw connections
-        std::vector<sf::Vertex> connectionVerts{};
-        for (const auto& net: block.nets) {
-            sf::Color col = conColour;
-            if (debugNet && debugNet.value() == net.ind) // sneaky debug overlay... rest down
-                col = debugConColour;
-            else if (editor.state == Editor::EditorState::Connecting &&
-                     ((editor.conStartCloNet && editor.conStartCloNet.value() == net.ind) ||
-                      (editor.conEndCloNet && editor.conEndCloNet.value() == net.ind))) {
-                col = highlightConColour; // editor hover color
-            }
+        blockRend.drawBorder(window);
 
-            for (const auto& con: net.obj) {
-                connectionVerts.emplace_back(sf::Vector2f(block.getPort(con.portRef1).portPos),
-                                             col);
-                connectionVerts.emplace_back(sf::Vector2f(block.getPort(con.portRef2).portPos),
-                                             col);
-            }
+        // draw connections and nodes
+        // tiles under both the old and new geometry of changed nets are invalidated
+        for (const auto& area: blockRend.sync()) invalidateTiles(area);
+        if (lodEnabled && pixPerCoord() < lodPixPerCoord) {
+            drawTiles(visible);
+        } else {
+            blockRend.draw(window, visible);
         }
-        window.draw(connectionVerts.data(), connectionVerts.size(), sf::PrimitiveType::Lines);
-
-        // draw nodes
-        for (const auto& node: block.nodes) {
-            if (block.getNodeConCount(node.ind) != 2) {
-                drawNode(node.obj.pos, nodeRad, nodeColour);
-            };
+        // highlighted nets are redrawn over the top in their colour
+        if (editor.state == Editor::EditorState::Connecting) { // editor hover color
+            if (editor.conStartCloNet)
+                drawNetOver(editor.conStartCloNet.value(), highlightConColour);
+            if (editor.conEndCloNet) drawNetOver(editor.conEndCloNet.value(), highlightConColour);
         }
+        if (debugNet) drawNetOver(debugNet.value(), debugConColour); // sneaky debug overlay...
+
+        markerVerts.clear();
 
         std::vector<sf::Vertex> lineVertecies{};
         // editor state based gui
@@ -370,23 +665,23 @@ class EditorRenderer {
         if (!editor.overlapPos.empty()) {
             ImGui::SetTooltip("Connection overlaps connected wires");
             for (const auto& pos: editor.overlapPos) {
-                drawNode(pos, nodeRad * newNodeScale, overlapColour);
+                drawNode(pos, blockRend.nodeRad * newNodeScale, overlapColour);
             }
         }
 
         switch (editor.state) {
         case Editor::EditorState::Idle:
-            drawNode(mouseCoord, nodeRad, cursorPointColour);
+            drawNode(mouseCoord, blockRend.nodeRad, cursorPointColour);
             if (typeOf(editor.conStartObjVar) == ObjAtCoordType::ConCross) {
-                drawNode(editor.conStartPos, newNodeScale * nodeRad, newConColour);
+                drawNode(editor.conStartPos, newNodeScale * blockRend.nodeRad, newConColour);
             }
             break;
         case Editor::EditorState::Connecting:
             if (editor.conEndLegal) {
                 drawSingleLine(lineVertecies, editor.conStartPos, editor.conEndPos, newConColour);
-                drawNode(editor.conEndPos, newNodeScale * nodeRad, newConColour);
+                drawNode(editor.conEndPos, newNodeScale * blockRend.nodeRad, newConColour);
             }
-            drawNode(editor.conStartPos, newNodeScale * nodeRad,
+            drawNode(editor.conStartPos, newNodeScale * blockRend.nodeRad,
                      editor.conEndLegal ? newConColour : errorColour);
             break;
         case Editor::EditorState::Deleting:
@@ -410,18 +705,20 @@ class EditorRenderer {
             for (const auto& con: net) {
                 // potentially multi draw when multi connected port
                 auto port = block.getPort(con.portRef1);
-                drawNode(port.portPos, nodeRad * newNodeScale, debugNodeColour);
+                drawNode(port.portPos, blockRend.nodeRad * newNodeScale, debugNodeColour);
                 port = block.getPort(con.portRef2);
-                drawNode(port.portPos, nodeRad * newNodeScale, debugNodeColour);
+                drawNode(port.portPos, blockRend.nodeRad * newNodeScale, debugNodeColour);
             }
         }
         if (debugNode) { // draw debug node over top
-            drawNode(block.nodes[debugNode.value()].pos, newNodeScale * nodeRad, debugNodeColour);
+            drawNode(block.nodes[debugNode.value()].pos, newNodeScale * blockRend.nodeRad,
+                     debugNodeColour);
         }
         if (debugCon) { // draw debug con over top
             drawSingleLine(lineVertecies, block.getPort(debugCon->portRef1).portPos,
                            block.getPort(debugCon->portRef2).portPos, debugConColour);
         }
+        window.draw(markerVerts.data(), markerVerts.size(), sf::PrimitiveType::Triangles);
         window.draw(lineVertecies.data(), lineVertecies.size(), sf::PrimitiveType::Lines);
     }
 };
@@ -1,18 +1,25 @@
 #pragma once
 
-#include <SFML/System/Vector2.hpp>
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <cmath>
 #include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <optional>
+#include <set>
 #include <stdexcept>
+#include <string>
+#include <vector>
 
+#include "details/Vec2.hpp"
 
-enum struct Direction : std::size_t { up = 0, down = 1, left = 2, right = 3 };
+
+enum struct Direction : std::uint8_t { up = 0, down = 1, left = 2, right = 3 };
 static constexpr std::array<std::string, 4> DirectionStrings{"up", "down", "left", "right"};
 
-inline sf::Vector2i dirToVec(Direction dir) {
+inline Vec2i dirToVec(Direction dir) {
     switch (dir) {
     case Direction::up:
         return {0, -1};
@@ -27,12 +34,12 @@ inline sf::Vector2i dirToVec(Direction dir) {
 }
 
 // note 0,0 = false
-inline bool isVecHoriVert(const sf::Vector2i& vec) { return ((vec.x != 0) != (vec.y != 0)); }
-inline bool isVecHoriVert(const sf::Vector2f& vec) { return ((vec.x != 0) != (vec.y != 0)); }
+inline bool isVecHoriVert(const Vec2i& vec) { return ((vec.x != 0) != (vec.y != 0)); }
+inline bool isVecHoriVert(const Vec2f& vec) { return ((vec.x != 0) != (vec.y != 0)); }
 
-inline int magPolar(const sf::Vector2i& vec) { return abs(vec.x) + abs(vec.y); }
+inline int magPolar(const Vec2i& vec) { return abs(vec.x) + abs(vec.y); }
 
-inline Direction vecToDir(const sf::Vector2i& vec) {
+inline Direction vecToDir(const Vec2i& vec) {
     assert(isVecHoriVert(vec));
     if (vec.y != 0) {
         return vec.y < 0 ? Direction::up : Direction::down;
@@ -40,7 +47,7 @@ inline Direction vecToDir(const sf::Vector2i& vec) {
     return vec.x < 0 ? Direction::left : Direction::right;
 }
 
-inline Direction vecToDir(const sf::Vector2f& vec) {
+inline Direction vecToDir(const Vec2f& vec) {
     assert(isVecHoriVert(vec));
     if (vec.y != 0) {
         return vec.y < 0 ? Direction::up : Direction::down;
@@ -48,9 +55,9 @@ inline Direction vecToDir(const sf::Vector2f& vec) {
     return vec.x < 0 ? Direction::left : Direction::right;
 }
 
-inline int dot(const sf::Vector2i& a, const sf::Vector2i& b) { return a.x * b.x + a.y * b.y; }
+inline int dot(const Vec2i& a, const Vec2i& b) { return a.x * b.x + a.y * b.y; }
 
-inline int dot(const Direction& a, const sf::Vector2i& b) { return dot(dirToVec(a), b); }
+inline int dot(const Direction& a, const Vec2i& b) { return dot(dirToVec(a), b); }
 
 inline Direction reverseDir(Direction dir) {
     int val = static_cast<int>(dir);
@@ -65,8 +72,7 @@ inline Direction swapXY(Direction dir) {
 }
 
 // NOTE: not inclusive
-inline bool isVecBetween(const sf::Vector2i& vec, const sf::Vector2i& end1,
-                         const sf::Vector2i& end2) {
+inline bool isVecBetween(const Vec2i& vec, const Vec2i& end1, const Vec2i& end2) {
     assert(isVecHoriVert(end1 - end2));
     auto mag1 = magPolar(vec - end1);
     auto mag2 = magPolar(end2 - vec);
@@ -74,15 +80,14 @@ inline bool isVecBetween(const sf::Vector2i& vec, const sf::Vector2i& end1,
     return mag1 + mag2 == magPolar(end2 - end1);
 }
 
-inline sf::Vector2i normalise(sf::Vector2i vec) {
+inline Vec2i normalise(Vec2i vec) {
     vec.x = (vec.x > 0) - (vec.x < 0);
     vec.y = (vec.y > 0) - (vec.y < 0);
     return vec;
 }
 
-inline std::optional<sf::Vector2i>
-getLineIntersection(const std::pair<sf::Vector2i, sf::Vector2i>& line1,
-                    const std::pair<sf::Vector2i, sf::Vector2i>& line2) {
+inline std::optional<Vec2i> getLineIntersection(const std::pair<Vec2i, Vec2i>& line1,
+                                                const std::pair<Vec2i, Vec2i>& line2) {
     auto diff1 = line1.second - line1.first;
     auto diff2 = line2.second - line2.first;
     assert(isVecHoriVert(diff1));
@@ -99,7 +104,61 @@ getLineIntersection(const std::pair<sf::Vector2i, sf::Vector2i>& line1,
     return line2.first + (dt * dir);
 }
 
-inline sf::Vector2i snapToAxis(const sf::Vector2i& vec) {
+// Finds every point where a line in lines1 crosses a line in lines2, excluding line ends like
+// getLineIntersection. Sweeps across x keeping the y of horizontal lines that span the sweep in a
+// sorted set, so cost is O((n+m)log(n+m) + k) rather than O(n*m)
+inline std::vector<Vec2i>
+getLineIntersections(const std::vector<std::pair<Vec2i, Vec2i>>& lines1,
+                     const std::vector<std::pair<Vec2i, Vec2i>>& lines2) {
+    std::vector<Vec2i> intersections{};
+    auto sweep = [&](const auto& horiLines, const auto& vertLines) {
+        // at the same x removals happen before queries and insertions after so ends are excluded
+        enum struct EventType { remove = 0, query = 1, insert = 2 };
+        struct Event {
+            int       x;
+            EventType type;
+            int       y1;
+            int       y2;
+        };
+        std::vector<Event> events{};
+        for (const auto& [end1, end2]: horiLines) {
+            if (end1.y != end2.y || end1.x == end2.x) continue;
+            events.push_back({std::min(end1.x, end2.x), EventType::insert, end1.y, end1.y});
+            events.push_back({std::max(end1.x, end2.x), EventType::remove, end1.y, end1.y});
+        }
+        if (events.empty()) return;
+        for (const auto& [end1, end2]: vertLines) {
+            if (end1.x != end2.x || end1.y == end2.y) continue;
+            events.push_back(
+                {end1.x, EventType::query, std::min(end1.y, end2.y), std::max(end1.y, end2.y)});
+        }
+        std::sort(events.begin(), events.end(), [](const Event& a, const Event& b) {
+            return a.x != b.x ? a.x < b.x : a.type < b.type;
+        });
+        std::multiset<int> activeY{};
+        for (const auto& event: events) {
+            switch (event.type) {
+            case EventType::insert:
+                activeY.insert(event.y1);
+                break;
+            case EventType::remove:
+                activeY.erase(activeY.find(event.y1));
+                break;
+            case EventType::query:
+                for (auto it = activeY.upper_bound(event.y1); it != activeY.end() && *it < event.y2;
+                     ++it) {
+                    intersections.emplace_back(event.x, *it);
+                }
+                break;
+            }
+        }
+    };
+    sweep(lines1, lines2);
+    sweep(lines2, lines1);
+    return intersections;
+}
+
+inline Vec2i snapToAxis(const Vec2i& vec) {
     if (abs(vec.x) > abs(vec.y)) {
         return {vec.x, 0};
     } else {
@@ -107,7 +166,7 @@ inline sf::Vector2i snapToAxis(const sf::Vector2i& vec) {
     }
 }
 
-inline sf::Vector2f snapToAxis(const sf::Vector2f& vec) {
+inline Vec2f snapToAxis(const Vec2f& vec) {
     if (std::abs(vec.x) > std::abs(vec.y)) {
         return {vec.x, 0};
     } else {
@@ -115,12 +174,12 @@ inline sf::Vector2f snapToAxis(const sf::Vector2f& vec) {
     }
 }
 
-inline float mag(const sf::Vector2f& vec) { return std::sqrt(vec.x * vec.x + vec.y * vec.y); }
-inline float mag(const sf::Vector2i& vec) {
+inline float mag(const Vec2f& vec) { return std::sqrt(vec.x * vec.x + vec.y * vec.y); }
+inline float mag(const Vec2i& vec) {
     return static_cast<float>(std::sqrt(vec.x * vec.x + vec.y * vec.y));
 }
 
-// inline bool isVecInDir(const sf::Vector2i& vec, Direction dir) {
+// inline bool isVecInDir(const Vec2i& vec, Direction dir) {
 //     assert(isVecHoriVert(vec));
 //     return dot(vec, dirToVec(dir)) > 0; // if dot prouct > 0 then must be in same dir
 // }
@@ -0,0 +1,185 @@
+#pragma once
+
+#include "BlockInternals.hpp"
+#include "absl/container/btree_map.h"
+
+// Sparse record of what occupies each grid coord
+// Kept up to date incrementally by Block so point lookups don't have to scan every node and net
+class OccupancyGrid {
+  public:
+    struct Cell {
+        std::optional<Ref<Node>>      node;
+        std::optional<Ref<Gate>>      gate;      // gate body
+        std::optional<Ref<BlockInst>> blockInst; // block instance body
+        std::optional<PortRef>        port;      // gate or block instance port
+        std::optional<Connection>     hori; // connection passing through coord (not ending at it)
+        std::optional<Connection>     vert;
+
+        [[nodiscard]] bool empty() const {
+            return !node && !gate && !blockInst && !port && !hori && !vert;
+        }
+    };
+
+  private:
+    // a row (y -> x) or column (x -> y) of sorted positions along it
+    template <typename T>
+    using Lines = absl::flat_hash_map<int, absl::btree_map<int, T>>;
+
+    absl::flat_hash_map<Vec2i, Cell> cells{};
+    Lines<Ref<Node>>                 nodeRows{};
+    Lines<Ref<Node>>                 nodeCols{};
+    // connections keyed by their lower end -> (upper end, con)
+    Lines<std::pair<int, Connection>> conRows{};
+    Lines<std::pair<int, Connection>> conCols{};
+
+    // line a horizontal (row) or vertical (col) position lies on and its position along it
+    static int lineOf(bool isHori, const Vec2i& pos) { return isHori ? pos.y : pos.x; }
+    static int alongOf(bool isHori, const Vec2i& pos) { return isHori ? pos.x : pos.y; }
+
+    template <typename T>
+    static void eraseFromLine(Lines<T>& lines, int line, int along) {
+        auto it = lines.find(line);
+        if (it == lines.end()) return;
+        it->second.erase(along);
+        if (it->second.empty()) lines.erase(it);
+    }
+
+    template <typename T>
+    static auto& bodyOf(Cell& cell) {
+        if constexpr (std::is_same_v<T, Gate>) {
+            return cell.gate;
+        } else {
+            return cell.blockInst;
+        }
+    }
+
+    void vacateIfEmpty(const Vec2i& coord) {
+        auto it = cells.find(coord);
+        if (it != cells.end() && it->second.empty()) cells.erase(it);
+    }
+
+    // calls func on every coord strictly between the two ends of a connection
+    template <typename F>
+    static void forEachBetween(const Vec2i& end1, const Vec2i& end2, F&& func) {
+        assert(isVecHoriVert(end2 - end1));
+        auto dir = normalise(end2 - end1);
+        for (auto coord = end1 + dir; coord != end2; coord += dir) func(coord);
+    }
+
+  public:
+    // returns nullptr if nothing is at coord
+    [[nodiscard]] const Cell* find(const Vec2i& coord) const {
+        auto it = cells.find(coord);
+        return it == cells.end() ? nullptr : &it->second;
+    }
+
+    void insertNode(const Vec2i& pos, Ref<Node> node) {
+        auto& cell = cells[pos];
+        if (cell.node && cell.node.value() != node)
+            throw std::logic_error("Tried to insert node on top of another node");
+        cell.node = node;
+        nodeRows[pos.y].insert_or_assign(pos.x, node);
+        nodeCols[pos.x].insert_or_assign(pos.y, node);
+    }
+
+    void eraseNode(const Vec2i& pos) {
+        auto it = cells.find(pos);
+        if (it == cells.end()) return;
+        it->second.node.reset();
+        vacateIfEmpty(pos);
+        eraseFromLine(nodeRows, pos.y, pos.x);
+        eraseFromLine(nodeCols, pos.x, pos.y);
+    }
+
+    // gates and block instances, a body at pos with ports around it
+    template <typename T>
+    void insertPortObj(Ref<T> ref, const T& obj) {
+        bodyOf<T>(cells[obj.pos]) = ref;
+        for (std::size_t portNum = 0; portNum < obj.ports.size(); ++portNum) {
+            cells[obj.ports[portNum].portPos].port = PortRef{ref, portNum};
+        }
+    }
+
+    template <typename T>
+    void erasePortObj(const T& obj) {
+        auto vacate = [&](const Vec2i& coord, auto reset) {
+            auto it = cells.find(coord);
+            if (it == cells.end()) return;
+            reset(it->second);
+            vacateIfEmpty(coord);
+        };
+        vacate(obj.pos, [](Cell& cell) { bodyOf<T>(cell).reset(); });
+        for (const auto& port: obj.ports) {
+            vacate(port.portPos, [](Cell& cell) { cell.port.reset(); });
+        }
+    }
+
+    void insertCon(const Connection& con, const Vec2i& pos1, const Vec2i& pos2) {
+        bool isHori = pos1.y == pos2.y;
+        forEachBetween(pos1, pos2, [&](const Vec2i& coord) {
+            auto& slot = isHori ? cells[coord].hori : cells[coord].vert;
+            if (slot && !(slot.value() == con))
+                throw std::logic_error("Should never be more than 2 connections overlapping");
+            slot = con;
+        });
+        auto [low, high] = std::minmax({alongOf(isHori, pos1), alongOf(isHori, pos2)});
+        auto& line       = (isHori ? conRows : conCols)[lineOf(isHori, pos1)];
+        line.insert_or_assign(low, std::pair{high, con});
+    }
+
+    void eraseCon(const Vec2i& pos1, const Vec2i& pos2) {
+        bool isHori = pos1.y == pos2.y;
+        forEachBetween(pos1, pos2, [&](const Vec2i& coord) {
+            auto it = cells.find(coord);
+            if (it == cells.end()) return;
+            (isHori ? it->second.hori : it->second.vert).reset();
+            vacateIfEmpty(coord);
+        });
+        eraseFromLine(isHori ? conRows : conCols, lineOf(isHori, pos1),
+                      std::min(alongOf(isHori, pos1), alongOf(isHori, pos2)));
+    }
+
+    // calls func on every node strictly between the two ends of a horizontal or vertical segment
+    // cost is proportional to the number of nodes found, not the length of the segment
+    template <typename F>
+    void forEachNodeBetween(const Vec2i& end1, const Vec2i& end2, F&& func) const {
+        assert(isVecHoriVert(end2 - end1));
+        bool        isHori = end1.y == end2.y;
+        const auto& lines  = isHori ? nodeRows : nodeCols;
+        auto        lineIt = lines.find(lineOf(isHori, end1));
+        if (lineIt == lines.end()) return;
+        const auto& line = lineIt->second;
+        auto [low, high] = std::minmax({alongOf(isHori, end1), alongOf(isHori, end2)});
+        for (auto it = line.upper_bound(low); it != line.end() && it->first < high; ++it) {
+            func(it->second);
+        }
+    }
+
+    // calls func on every connection running along a horizontal or vertical segment which overlaps
+    // its interior
+    template <typename F>
+    void forEachConAlong(const Vec2i& end1, const Vec2i& end2, F&& func) const {
+        assert(isVecHoriVert(end2 - end1));
+        bool        isHori = end1.y == end2.y;
+        const auto& lines  = isHori ? conRows : conCols;
+        auto        lineIt = lines.find(lineOf(isHori, end1));
+        if (lineIt == lines.end()) return;
+        const auto& line = lineIt->second;
+        auto [low, high] = std::minmax({alongOf(isHori, end1), alongOf(isHori, end2)});
+        // cons on a line never overlap so only the one starting before low can reach past it
+        auto it = line.upper_bound(low);
+        if (it != line.begin()) --it;
+        for (; it != line.end() && it->first < high; ++it) {
+            if (it->second.first > low) func(it->second.second);
+        }
+    }
+
+    [[nodiscard]] std::size_t size() const { return cells.size(); }
+    void                      clear() {
+        cells.clear();
+        nodeRows.clear();
+        nodeCols.clear();
+        conRows.clear();
+        conCols.clear();
+    }
+};
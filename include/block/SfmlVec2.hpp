@@ -0,0 +1,16 @@
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+
+#include "details/Vec2.hpp"
+
+// conversions between the core's Vec2 and SFML's vectors, for the editor and renderers
+template <typename T>
+sf::Vector2<T> toSf(const Vec2<T>& vec) {
+    return {vec.x, vec.y};
+}
+
+template <typename T>
+Vec2<T> fromSf(const sf::Vector2<T>& vec) {
+    return {vec.x, vec.y};
+}
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Lightweight scoped timers for finding which part of a frame is slow
+// Only compiled in when TECHNO_LOGIC_PROFILING is defined, otherwise the macros expand to nothing
+// CMake only defines it for the editor app, so time whole frames and phases, not hot lookups
+// Hot block lookups are counted with PROFILE_COUNT at the editor's call sites instead
+// Not thread safe, all timed code is expected to run on the main thread
+
+// fixed size history of the most recent values, oldest are overwritten
+template <typename T, std::size_t N>
+class RingBuffer {
+    std::array<T, N> data{};
+    std::size_t      next  = 0;
+    std::size_t      count = 0;
+
+  public:
+    void push(const T& value) {
+        data[next] = value;
+        next       = (next + 1) % N;
+        count      = std::min(count + 1, N);
+    }
+
+    [[nodiscard]] std::size_t size() const { return count; }
+    [[nodiscard]] bool        empty() const { return count == 0; }
+    static constexpr std::size_t capacity() { return N; }
+
+    // i = 0 is the oldest value held
+    [[nodiscard]] const T& operator[](std::size_t i) const {
+        return data[(next + N - count + i) % N];
+    }
+    [[nodiscard]] const T& back() const { return data[(next + N - 1) % N]; }
+
+    // p in [0, 1], nearest rank
+    [[nodiscard]] T percentile(double p) const {
+        if (count == 0) return T{};
+        std::vector<T> sorted(data.begin(), data.begin() + static_cast<std::ptrdiff_t>(count));
+        auto rank = static_cast<std::size_t>(p * static_cast<double>(count - 1) + 0.5);
+        std::nth_element(sorted.begin(), sorted.begin() + static_cast<std::ptrdiff_t>(rank),
+                         sorted.end());
+        return sorted[rank];
+    }
+
+    // copies into a contiguous oldest to newest array, for plotting
+    void linearise(std::vector<T>& out) const {
+        out.resize(count);
+        for (std::size_t i = 0; i < count; ++i) out[i] = (*this)[i];
+    }
+};
+
+class Profiler {
+  public:
+    using Clock                              = std::chrono::steady_clock;
+    static constexpr std::size_t historySize = 240; // frames
+
+    // durations are summed over a frame, history is one entry per frame
+    struct Section {
+        std::string                            name;
+        double                                 frameMicros = 0;
+        std::uint32_t                          frameCalls  = 0;
+        RingBuffer<float, historySize>         micros;
+        RingBuffer<std::uint32_t, historySize> calls;
+    };
+    // calls counted without timing them, for lookups too hot to read the clock around
+    struct Counter {
+        std::string                            name;
+        std::uint32_t                          frameCount = 0;
+        RingBuffer<std::uint32_t, historySize> counts;
+    };
+
+  private:
+    std::vector<Section>           sections;
+    std::vector<Counter>           counters;
+    RingBuffer<float, historySize> frameMillis;
+    Clock::time_point              frameStart = Clock::now();
+
+  public:
+    bool enabled = false; // off until the app turns it on so tests and benchmarks stay untimed
+
+    static Profiler& get() {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    // same name always gives the same id
+    std::size_t registerSection(const char* name) {
+        auto it = std::find_if(sections.begin(), sections.end(),
+                               [&](const Section& sec) { return sec.name == name; });
+        if (it != sections.end()) return static_cast<std::size_t>(it - sections.begin());
+        sections.push_back({name, 0, 0, {}, {}});
+        return sections.size() - 1;
+    }
+
+    // same name always gives the same id
+    std::size_t registerCounter(const char* name) {
+        auto it = std::find_if(counters.begin(), counters.end(),
+                               [&](const Counter& counter) { return counter.name == name; });
+        if (it != counters.end()) return static_cast<std::size_t>(it - counters.begin());
+        counters.push_back({name, 0, {}});
+        return counters.size() - 1;
+    }
+
+    void count(std::size_t id) { ++counters[id].frameCount; }
+
+    void record(std::size_t id, Clock::duration elapsed) {
+        auto& sec = sections[id];
+        sec.frameMicros += std::chrono::duration<double, std::micro>(elapsed).count();
+        ++sec.frameCalls;
+    }
+
+    // closes off the current frame, pushing its totals into the histories
+    void endFrame() { finishFrame(true); }
+    // throws away anything recorded since the last frame, eg. when no frame was drawn
+    void skipFrame() { finishFrame(false); }
+
+  private:
+    void finishFrame(bool keep) {
+        auto now = Clock::now();
+        if (enabled && keep) {
+            frameMillis.push(
+                std::chrono::duration<float, std::milli>(now - frameStart).count());
+            for (auto& sec: sections) {
+                sec.micros.push(static_cast<float>(sec.frameMicros));
+                sec.calls.push(sec.frameCalls);
+            }
+            for (auto& counter: counters) counter.counts.push(counter.frameCount);
+        }
+        for (auto& sec: sections) {
+            sec.frameMicros = 0;
+            sec.frameCalls  = 0;
+        }
+        for (auto& counter: counters) counter.frameCount = 0;
+        frameStart = now;
+    }
+
+  public:
+    [[nodiscard]] const std::vector<Section>&           getSections() const { return sections; }
+    [[nodiscard]] const std::vector<Counter>&           getCounters() const { return counters; }
+    [[nodiscard]] const RingBuffer<float, historySize>& getFrameMillis() const {
+        return frameMillis;
+    }
+};
+
+// records the time from construction to destruction against a section
+class ScopedTimer {
+    std::size_t                 id;
+    bool                        active;
+    Profiler::Clock::time_point start;
+
+  public:
+    explicit ScopedTimer(std::size_t id_)
+        : id(id_), active(Profiler::get().enabled),
+          start(active ? Profiler::Clock::now() : Profiler::Clock::time_point{}) {}
+    ScopedTimer(const ScopedTimer&)            = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+    ~ScopedTimer() {
+        if (active) Profiler::get().record(id, Profiler::Clock::now() - start);
+    }
+};
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+
+#ifdef TECHNO_LOGIC_PROFILING
+// times the rest of the enclosing scope under name
+#define PROFILE_SCOPE(name)                                                                        \
+    static const std::size_t PROFILE_CONCAT(profileId, __LINE__) =                                 \
+        Profiler::get().registerSection(name);                                                     \
+    const ScopedTimer PROFILE_CONCAT(profileTimer, __LINE__) {                                     \
+        PROFILE_CONCAT(profileId, __LINE__)                                                        \
+    }
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
+// counts a call under name without reading the clock
+#define PROFILE_COUNT(name)                                                                        \
+    static const std::size_t PROFILE_CONCAT(profileCountId, __LINE__) =                            \
+        Profiler::get().registerCounter(name);                                                     \
+    Profiler::get().count(PROFILE_CONCAT(profileCountId, __LINE__))
+#define PROFILE_END_FRAME() Profiler::get().endFrame()
+#define PROFILE_SKIP_FRAME() Profiler::get().skipFrame()
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+#define PROFILE_COUNT(name)
+#define PROFILE_END_FRAME()
+#define PROFILE_SKIP_FRAME()
+#endif
@@ -6,6 +6,7 @@
 #include "absl/container/flat_hash_map.h"
 
 struct DefRefTag;
+class PortRef;
 
 template <typename, typename>
 class PepperedVector;
@@ -43,6 +44,7 @@ struct Ref {
     friend class PepperedVector<T, RefTag>;
     friend class CompactMap<T, RefTag>;
     friend class std::hash<Ref<T, RefTag>>;
+    friend class PortRef;
 
   public:
     Ref(const Ref& obj)            = default; // copy constructor
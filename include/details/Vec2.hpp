@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <utility>
+
+// Minimal 2D vector so the block model doesn't depend on SFML
+// Mirrors the parts of sf::Vector2 the core uses, see block/SfmlVec2.hpp for converting
+template <typename T>
+struct Vec2 {
+    T x{};
+    T y{};
+
+    constexpr Vec2() = default;
+    constexpr Vec2(T x_, T y_) : x(x_), y(y_) {}
+    template <typename U>
+    constexpr explicit Vec2(const Vec2<U>& other)
+        : x(static_cast<T>(other.x)), y(static_cast<T>(other.y)) {}
+
+    constexpr bool operator==(const Vec2&) const = default;
+
+    constexpr Vec2  operator-() const { return {-x, -y}; }
+    constexpr Vec2  operator+(const Vec2& other) const { return {x + other.x, y + other.y}; }
+    constexpr Vec2  operator-(const Vec2& other) const { return {x - other.x, y - other.y}; }
+    constexpr Vec2  operator*(T scale) const { return {x * scale, y * scale}; }
+    constexpr Vec2  operator/(T scale) const { return {x / scale, y / scale}; }
+    constexpr Vec2& operator+=(const Vec2& other) { return *this = *this + other; }
+    constexpr Vec2& operator-=(const Vec2& other) { return *this = *this - other; }
+    friend constexpr Vec2 operator*(T scale, const Vec2& vec) { return vec * scale; }
+
+    template <typename H>
+    friend H AbslHashValue(H h, const Vec2& vec) {
+        return H::combine(std::move(h), vec.x, vec.y);
+    }
+};
+
+using Vec2i = Vec2<int>;
+using Vec2f = Vec2<float>;
+
+template <>
+struct std::hash<Vec2i> {
+    std::size_t operator()(const Vec2i& vec) const {
+        auto x = static_cast<std::uint64_t>(static_cast<std::uint32_t>(vec.x));
+        auto y = static_cast<std::uint64_t>(static_cast<std::uint32_t>(vec.y));
+        return std::hash<std::uint64_t>{}((x << 32U) | y);
+    }
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Netlist.hpp"
+#include "PatternWord.hpp"
+#include "details/Profiler.hpp"
+
+// Evaluates Word::patternCount independent input patterns through a combinational Netlist at once
+// Each net holds one bit per pattern so every gate op evaluates all of them
+template <typename Word = WidestPatternWord>
+class BitParallelSimulator {
+  private:
+    const Netlist&    netlist;
+    std::vector<Word> values;
+
+  public:
+    static constexpr std::size_t patternCount = Word::patternCount;
+
+    explicit BitParallelSimulator(const Netlist& netlist_)
+        : netlist(netlist_), values(netlist_.netCount) {
+        if (!netlist.isLevelized())
+            throw std::runtime_error("Block has a combinational loop so can't be levelized");
+    }
+
+    // only meaningful for the netlist's free nets, driven nets are overwritten by evaluate()
+    void                      set(NetId net, const Word& patterns) { values.at(net) = patterns; }
+    [[nodiscard]] const Word& get(NetId net) const { return values.at(net); }
+    void set(NetId net, std::size_t pattern, bool value) { values.at(net).set(pattern, value); }
+    [[nodiscard]] bool get(NetId net, std::size_t pattern) const {
+        return values.at(net).get(pattern);
+    }
+
+    void evaluate() {
+        PROFILE_FUNCTION();
+        evaluateGates(netlist, 0, netlist.gates.size(), values.data());
+    }
+};
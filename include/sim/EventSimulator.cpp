@@ -0,0 +1,67 @@
+#include "EventSimulator.hpp"
+
+EventSimulator::EventSimulator(const Netlist& netlist_)
+    : netlist(netlist_), values(netlist_.netCount, 0), projected(netlist_.netCount, 0),
+      dirtyGates(netlist_.gates.size()), isDirty(netlist_.gates.size(), true) {
+    for (std::uint32_t gateNum = 0; gateNum < dirtyGates.size(); ++gateNum) {
+        dirtyGates[gateNum] = gateNum;
+    }
+}
+
+void EventSimulator::schedule(NetId net, std::uint8_t value, std::uint64_t when) {
+    projected[net] = value;
+    wheel[when % wheelSize].push_back({net, value});
+    ++scheduled;
+}
+
+void EventSimulator::set(NetId net, bool value) {
+    std::uint8_t word = value ? 0xFF : 0x00;
+    if (projected.at(net) != word) schedule(net, word, tick);
+}
+
+void EventSimulator::step() {
+    changed.clear();
+    auto& bucket = wheel[tick % wheelSize];
+    scheduled -= bucket.size();
+    for (auto [net, value]: bucket) {
+        if (values[net] == value) continue; // changed back before this took effect
+        values[net] = value;
+        changed.push_back(net);
+        for (auto i = netlist.fanoutBegins[net]; i < netlist.fanoutBegins[net + 1]; ++i) {
+            auto gateNum = netlist.fanout[i];
+            if (isDirty[gateNum]) continue;
+            isDirty[gateNum] = true;
+            dirtyGates.push_back(gateNum);
+        }
+    }
+    bucket.clear();
+
+    // gate delays are at least one tick so nothing scheduled here lands in this tick's bucket
+    for (auto gateNum: dirtyGates) {
+        const auto& gate = netlist.gates[gateNum];
+        isDirty[gateNum] = false;
+        auto value       = evaluateGate(netlist, gate, values.data());
+        auto net         = netOf(gate.output);
+        if (value != projected[net]) schedule(net, value, tick + gate.delay);
+    }
+    evaluations += dirtyGates.size();
+    dirtyGates.clear();
+    ++tick;
+}
+
+void EventSimulator::run(std::uint64_t ticks) {
+    auto end = tick + ticks;
+    while (tick < end) {
+        if (isSettled()) {
+            tick = end;
+            changed.clear();
+            return;
+        }
+        step();
+    }
+}
+
+bool EventSimulator::settle(std::uint64_t maxTicks) {
+    for (std::uint64_t i = 0; i < maxTicks && !isSettled(); ++i) step();
+    return isSettled();
+}
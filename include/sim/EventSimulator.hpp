@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Netlist.hpp"
+
+// Simulates a Netlist tick by tick, only re-evaluating gates whose inputs changed
+// Works on any netlist including ones with feedback loops (latches, oscillators...). Each gate's
+// output changes Gate::delay ticks after its inputs do; pending changes wait in a timing wheel
+// with one bucket per tick, so idle ticks and idle parts of the design cost nothing.
+class EventSimulator {
+  public:
+    static constexpr std::size_t wheelSize = 256; // longer than any gate delay
+
+  private:
+    struct Event {
+        NetId        net;
+        std::uint8_t value;
+    };
+
+    const Netlist&                            netlist;
+    std::vector<std::uint8_t>                 values;    // same encoding as LevelSimulator
+    std::vector<std::uint8_t>                 projected; // value once scheduled events are done
+    std::array<std::vector<Event>, wheelSize> wheel;     // events for tick t are in [t % size]
+    std::size_t                               scheduled = 0;
+    std::vector<std::uint32_t>                dirtyGates; // to evaluate this tick
+    std::vector<bool>                         isDirty;
+    std::vector<NetId>                        changed; // nets changed by the last step()
+    std::uint64_t                             tick        = 0;
+    std::uint64_t                             evaluations = 0;
+
+    void schedule(NetId net, std::uint8_t value, std::uint64_t when);
+
+  public:
+    // every gate is evaluated on the first step so outputs start consistent with their inputs
+    explicit EventSimulator(const Netlist& netlist_);
+
+    // takes effect on the next step(), only meaningful for the netlist's free nets
+    void               set(NetId net, bool value);
+    [[nodiscard]] bool get(NetId net) const { return (values.at(net) & 1U) != 0; }
+
+    [[nodiscard]] std::uint64_t             now() const { return tick; }
+    [[nodiscard]] const std::vector<NetId>& changedNets() const { return changed; }
+    [[nodiscard]] bool isSettled() const { return scheduled == 0 && dirtyGates.empty(); }
+    // gates evaluated so far, a measure of activity
+    [[nodiscard]] std::uint64_t getEvaluationCount() const { return evaluations; }
+
+    // applies this tick's events and evaluates the gates they reach
+    void step();
+    // steps ticks times, skipping straight to the end once settled
+    void run(std::uint64_t ticks);
+    // steps until nothing is pending, returns false if still active after maxTicks
+    bool settle(std::uint64_t maxTicks);
+};
@@ -0,0 +1,106 @@
+#include "KernelCache.hpp"
+
+// Objects sorted by position so the order they were added in doesn't matter, each record is
+// prefixed with its length so no two different blocks encode the same
+const KernelCache::LocalContent& KernelCache::localContent(Ref<Block> blockRef) {
+    const auto& block = blocks[blockRef];
+    auto        it    = localContents.find(blockRef);
+    if (it != localContents.end() && it->second.generation == block.getGeneration())
+        return it->second;
+
+    std::vector<Key> gates;
+    for (const auto& [gateRef, gate]: block.gates) {
+        Key record{gate.pos.x, gate.pos.y, static_cast<std::int64_t>(gate.type), gate.delay};
+        for (const auto& port: gate.ports) {
+            record.insert(record.end(), {port.portPos.x, port.portPos.y,
+                                         static_cast<std::int64_t>(port.portType), port.negated});
+        }
+        gates.push_back(std::move(record));
+    }
+    std::vector<std::array<std::int64_t, 4>> cons;
+    for (const auto& [netRef, net]: block.nets) {
+        for (const auto& con: net) {
+            auto pos1 = block.getPort(con.portRef1).portPos;
+            auto pos2 = block.getPort(con.portRef2).portPos;
+            if (std::pair(pos2.x, pos2.y) < std::pair(pos1.x, pos1.y)) std::swap(pos1, pos2);
+            cons.push_back({pos1.x, pos1.y, pos2.x, pos2.y});
+        }
+    }
+    std::vector<std::pair<Key, Ref<Block>>> insts;
+    for (const auto& [instRef, inst]: block.blockInstances) {
+        Key record{inst.pos.x, inst.pos.y};
+        for (const auto& port: inst.ports) {
+            record.insert(record.end(), {port.portPos.x, port.portPos.y,
+                                         static_cast<std::int64_t>(port.portType)});
+        }
+        insts.emplace_back(std::move(record), inst.block);
+    }
+    std::ranges::sort(gates);
+    std::ranges::sort(cons);
+    std::ranges::sort(insts, {}, [](const auto& inst) -> const Key& { return inst.first; });
+
+    LocalContent content{block.getGeneration(), {}, {}};
+    auto         append = [&](const Key& record) {
+        content.key.push_back(static_cast<std::int64_t>(record.size()));
+        content.key.insert(content.key.end(), record.begin(), record.end());
+    };
+    content.key.push_back(static_cast<std::int64_t>(gates.size()));
+    for (const auto& record: gates) append(record);
+    content.key.push_back(static_cast<std::int64_t>(cons.size()));
+    for (const auto& con: cons) content.key.insert(content.key.end(), con.begin(), con.end());
+    content.key.push_back(static_cast<std::int64_t>(insts.size()));
+    for (const auto& [record, child]: insts) {
+        append(record);
+        content.children.push_back(child);
+    }
+    return localContents.insert_or_assign(blockRef, std::move(content)).first->second;
+}
+
+// Ports are added every time as editing them doesn't bump the block's generation
+// Without compile it only finds kernels that already exist, nullptr if there's none
+const KernelCache::Kernel* KernelCache::lookup(Ref<Block> blockRef, KernelMemo& memo,
+                                               bool compile) {
+    if (!blocks.contains(blockRef)) throw std::logic_error("Block isn't in the library");
+    auto [it, inserted] = memo.try_emplace(blockRef, nullptr);
+    if (!inserted) {
+        if (!it->second && compile) throw std::logic_error("Block contains an instance of itself");
+        return it->second;
+    }
+    const auto& block = blocks[blockRef];
+    const auto& local = localContent(blockRef);
+    Key         key   = local.key;
+    for (const auto& port: block.ports) {
+        key.insert(key.end(), {static_cast<std::int64_t>(port.type), port.pos.x, port.pos.y});
+    }
+    for (auto child: local.children) {
+        const auto* kernel = lookup(child, memo, compile);
+        if (!kernel) return nullptr;
+        key.push_back(static_cast<std::int64_t>(kernel->id));
+    }
+
+    auto found = kernels.find(key);
+    if (found == kernels.end()) {
+        if (!compile) return nullptr;
+        Netlist netlist(block, [&](Ref<Block> child) -> const Netlist& {
+            return lookup(child, memo, true)->netlist;
+        });
+        found = kernels.try_emplace(std::move(key), Kernel{std::move(netlist), compileCount++})
+                    .first;
+    }
+    memo.at(blockRef) = &found->second; // it may have been invalidated by rehashing
+    return &found->second;
+}
+
+const Netlist& KernelCache::get(Ref<Block> blockRef) {
+    KernelMemo memo;
+    return lookup(blockRef, memo, true)->netlist;
+}
+
+void KernelCache::pruneUnused() {
+    absl::flat_hash_set<const Kernel*> used;
+    KernelMemo                         memo;
+    for (const auto& [blockRef, block]: blocks) used.insert(lookup(blockRef, memo, false));
+    absl::erase_if(kernels, [&](const auto& kernel) { return !used.contains(&kernel.second); });
+    absl::erase_if(localContents,
+                   [&](const auto& local) { return !blocks.contains(local.first); });
+}
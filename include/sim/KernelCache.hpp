@@ -0,0 +1,52 @@
+#pragma once
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/container/node_hash_map.h"
+
+#include "Netlist.hpp"
+
+// Compiled netlists of a library of blocks, shared between every instance of the same content
+// Kernels are keyed by what a block contains rather than which block it is, so identical copies
+// compile once and an edit only recompiles the blocks above it. The key ignores Ref numbering,
+// so undoing an edit or redrawing the same wires finds the old kernel. Keys are compared in
+// full on a hit, and Netlists refer to nets and gates by position, so a kernel is right for
+// every block that shares it.
+class KernelCache {
+  private:
+    // canonical encoding of a block's content, children by the id of their kernel
+    using Key = std::vector<std::int64_t>;
+    struct Kernel {
+        Netlist     netlist;
+        std::size_t id;
+    };
+    struct LocalContent {
+        std::uint64_t           generation;
+        Key                     key;      // gates, connections and instance geometry
+        std::vector<Ref<Block>> children; // block of each instance in the order key has them
+    };
+    // kernel of each block already visited, nullptr while a block is still being looked up
+    using KernelMemo = absl::flat_hash_map<Ref<Block>, const Kernel*>;
+
+    const StableVector<Block>&                    blocks;
+    absl::node_hash_map<Ref<Block>, LocalContent> localContents; // stable while children are added
+    absl::node_hash_map<Key, Kernel>              kernels;
+    std::size_t                                   compileCount = 0;
+
+    const LocalContent& localContent(Ref<Block> blockRef);
+    const Kernel*       lookup(Ref<Block> blockRef, KernelMemo& memo, bool compile);
+
+  public:
+    // Block content is cached per block by generation, so replacing a library block at the same
+    // Ref needs a new KernelCache
+    explicit KernelCache(const StableVector<Block>& blocks_) : blocks(blocks_) {}
+
+    // compiles the block and any blocks it instances the first time their content is seen
+    // throws if a block contains itself, the reference stays valid until pruneUnused()
+    const Netlist& get(Ref<Block> blockRef);
+
+    [[nodiscard]] std::size_t getCompileCount() const { return compileCount; }
+    [[nodiscard]] std::size_t size() const { return kernels.size(); }
+
+    // drops kernels that no block in the library currently compiles to
+    void pruneUnused();
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Netlist.hpp"
+#include "details/Profiler.hpp"
+
+// Evaluates a combinational Netlist level by level, every gate once per evaluate()
+// Values are kept one byte per net with every bit equal, so the bitwise gate ops act as booleans
+// Use EventSimulator for blocks with feedback loops
+class LevelSimulator {
+  private:
+    const Netlist&            netlist;
+    std::vector<std::uint8_t> values;
+
+  public:
+    explicit LevelSimulator(const Netlist& netlist_)
+        : netlist(netlist_), values(netlist_.netCount, 0) {
+        if (!netlist.isLevelized())
+            throw std::runtime_error("Block has a combinational loop so can't be levelized");
+    }
+
+    // only meaningful for the netlist's free nets, driven nets are overwritten by evaluate()
+    void set(NetId net, bool value) { values.at(net) = value ? 0xFF : 0x00; }
+    [[nodiscard]] bool get(NetId net) const { return (values.at(net) & 1U) != 0; }
+
+    void evaluate() {
+        PROFILE_FUNCTION();
+        evaluateGates(netlist, 0, netlist.gates.size(), values.data());
+    }
+};
@@ -0,0 +1,232 @@
+#include "Netlist.hpp"
+
+static void addDriver(std::vector<bool>& driven, NetId net) {
+    if (net >= driven.size()) driven.resize(net + 1, false);
+    if (driven[net]) throw std::logic_error("Net has two drivers");
+    driven[net] = true;
+}
+
+// net of whatever is at pos, nullopt if there's nothing there to join
+static std::optional<Ref<ClosedNet>> netRefAt(const Block& block, const Vec2i& pos) {
+    auto obj = block.whatIsAtCoord(pos);
+    switch (typeOf(obj)) {
+    case ObjAtCoordType::Con:
+        return block.getClosNetRef(std::get<Connection>(obj));
+    case ObjAtCoordType::ConCross:
+        throw std::logic_error("Block port is on a crossing so could join either net");
+    case ObjAtCoordType::Port:
+        return block.getClosNetRef(std::get<PortRef>(obj));
+    case ObjAtCoordType::Node:
+        return block.getClosNetRef(std::get<Ref<Node>>(obj));
+    default:
+        return {};
+    }
+}
+
+// same for any block with the same content, whichever Refs its objects were given
+static Vec2i lowestPortPos(const Block& block, const ClosedNet& net) {
+    std::optional<Vec2i> lowest;
+    for (const auto& con: net) {
+        for (const auto& portRef: {con.portRef1, con.portRef2}) {
+            auto pos = block.getPort(portRef).portPos;
+            if (!lowest || std::pair(pos.y, pos.x) < std::pair(lowest->y, lowest->x)) {
+                lowest = pos;
+            }
+        }
+    }
+    if (!lowest) throw std::logic_error("Net has no connections");
+    return lowest.value();
+}
+
+Netlist::Netlist(const Block& block, const KernelLookup& kernels) {
+    if (block.isBatching()) throw std::logic_error("Can't compile a block while batching");
+    if (!block.blockInstances.empty() && !kernels)
+        throw std::logic_error("Block has instances but no kernels to flatten them with");
+
+    anchors.resize(block.nets.size() + 1);
+    for (const auto& [netRef, net]: block.nets) {
+        auto id = static_cast<NetId>(netCount++);
+        netIds.emplace(netRef, id);
+        anchors[id] = lowestPortPos(block, net);
+        netAnchors.emplace(anchors[id], id);
+    }
+    for (const auto& port: block.ports) portNets.push_back(netAt(block, port.pos));
+
+    // gate records in block order then each instance's, levelized below
+    std::vector<bool> driven(netCount, false);
+    for (const auto& [gateRef, gate]: block.gates) {
+        if (gate.delay == 0) throw std::logic_error("Gate delay must be at least one tick");
+        auto record =
+            GateRecord{gate.type, gate.delay, static_cast<std::uint32_t>(operands.size()), 0, 0};
+        for (std::size_t portNum = 0; portNum < gate.ports.size(); ++portNum) {
+            const auto& port = gate.ports[portNum];
+            auto        net  = block.getClosNetRef(PortRef{gateRef, portNum});
+            if (port.portType == PortType::input) {
+                operands.push_back(makeOperand(net ? netIds.at(net.value()) : constantLow,
+                                               port.negated));
+            } else { // unconnected outputs still need somewhere to write
+                auto id = net ? netIds.at(net.value()) : static_cast<NetId>(netCount++);
+                addDriver(driven, id);
+                record.output = makeOperand(id, port.negated != (gate.type == GateType::Not));
+            }
+        }
+        record.operandEnd = static_cast<std::uint32_t>(operands.size());
+        if (record.type == GateType::Not) record.type = GateType::Xor;
+        gates.push_back(record);
+        gateSources.push_back(GateSource{gate.pos});
+    }
+    for (const auto& [instRef, inst]: block.blockInstances) {
+        flatten(block, instRef, kernels(inst.block), driven);
+    }
+
+    // instances already added theirs, some may be driven from outside
+    driven.resize(netCount, false);
+    for (const auto& [netRef, id]: netIds) freeNets.push_back(id);
+    freeNets.insert(freeNets.end(), portNets.begin(), portNets.end());
+    std::erase_if(freeNets, [&](NetId id) { return driven[id]; });
+    std::ranges::sort(freeNets);
+    freeNets.erase(std::ranges::unique(freeNets).begin(), freeNets.end());
+
+    fanoutBegins.assign(netCount + 1, 0);
+    for (auto operand: operands) ++fanoutBegins[netOf(operand) + 1];
+    for (std::size_t net = 0; net < netCount; ++net) fanoutBegins[net + 1] += fanoutBegins[net];
+    fanout.resize(operands.size());
+    auto next = fanoutBegins;
+    for (std::uint32_t gateNum = 0; gateNum < gates.size(); ++gateNum) {
+        for (auto i = gates[gateNum].operandBegin; i < gates[gateNum].operandEnd; ++i) {
+            fanout[next[netOf(operands[i])]++] = gateNum;
+        }
+    }
+
+    levelize();
+}
+
+// net of whatever is at pos, a new unconnected one if there's nothing to join
+NetId Netlist::netAt(const Block& block, const Vec2i& pos) {
+    auto net = netRefAt(block, pos);
+    return net ? netIds.at(net.value()) : static_cast<NetId>(netCount++);
+}
+
+// Copies the instance's kernel in, its port nets become the nets on the instance's ports and
+// everything else inside gets fresh ids
+void Netlist::flatten(const Block& block, Ref<BlockInst> instRef, const Netlist& kernel,
+                      std::vector<bool>& driven) {
+    const auto& inst = block.blockInstances[instRef];
+    if (kernel.portNets.size() != inst.ports.size())
+        throw std::logic_error("Instance ports don't match its block's ports");
+
+    constexpr auto     unmapped = std::numeric_limits<NetId>::max();
+    std::vector<NetId> ids(kernel.netCount, unmapped);
+    ids[constantLow] = constantLow;
+    for (std::size_t portNum = 0; portNum < inst.ports.size(); ++portNum) {
+        auto net = block.getClosNetRef(PortRef{instRef, portNum});
+        if (!net) continue;
+        auto& id = ids[kernel.portNets[portNum]];
+        if (id != unmapped && id != netIds.at(net.value()))
+            throw std::runtime_error("Instance connects ports its block joins to different nets");
+        id = netIds.at(net.value());
+    }
+    for (auto& id: ids) {
+        if (id == unmapped) id = static_cast<NetId>(netCount++);
+    }
+
+    for (auto net: kernel.freeNets) freeNets.push_back(ids[net]);
+
+    auto remap = [&](Operand operand) {
+        return makeOperand(ids[netOf(operand)], isNegated(operand));
+    };
+    for (std::uint32_t gateNum = 0; gateNum < kernel.gates.size(); ++gateNum) {
+        auto record = kernel.gates[gateNum];
+        auto begin  = static_cast<std::uint32_t>(operands.size());
+        for (auto i = record.operandBegin; i < record.operandEnd; ++i) {
+            operands.push_back(remap(kernel.operands[i]));
+        }
+        record.operandBegin = begin;
+        record.operandEnd   = static_cast<std::uint32_t>(operands.size());
+        record.output       = remap(record.output);
+        addDriver(driven, netOf(record.output));
+        gates.push_back(record);
+        gateSources.push_back(GateSource{inst.pos, gateNum});
+    }
+}
+
+// Sorts gates by level with Kahn's algorithm, leaves them alone if there's a loop
+void Netlist::levelize() {
+    std::vector<bool> driven(netCount, false);
+    for (const auto& gate: gates) driven[netOf(gate.output)] = true;
+    std::vector<std::uint32_t> pending(gates.size(), 0); // inputs from unevaluated gates
+    for (NetId net = 0; net < netCount; ++net) {
+        if (!driven[net]) continue;
+        for (auto i = fanoutBegins[net]; i < fanoutBegins[net + 1]; ++i) ++pending[fanout[i]];
+    }
+    std::vector<std::uint32_t> level(gates.size(), 0);
+    std::vector<std::uint32_t> order;
+    order.reserve(gates.size());
+    for (std::uint32_t gateNum = 0; gateNum < gates.size(); ++gateNum) {
+        if (pending[gateNum] == 0) order.push_back(gateNum);
+    }
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        auto gateNum = order[i];
+        auto net     = netOf(gates[gateNum].output);
+        for (auto j = fanoutBegins[net]; j < fanoutBegins[net + 1]; ++j) {
+            auto reader   = fanout[j];
+            level[reader] = std::max(level[reader], level[gateNum] + 1);
+            if (--pending[reader] == 0) order.push_back(reader);
+        }
+    }
+    if (order.size() != gates.size()) return; // combinational loop
+
+    // counting sort by level, keeping each gate's operands contiguous in the new order
+    std::uint32_t levels = gates.empty() ? 0 : std::ranges::max(level) + 1;
+    levelBegins.assign(levels + 1, 0);
+    for (auto l: level) ++levelBegins[l + 1];
+    for (std::size_t l = 0; l < levels; ++l) levelBegins[l + 1] += levelBegins[l];
+    auto                       next = levelBegins;
+    std::vector<std::uint32_t> position(gates.size()); // new position of each gate
+    std::vector<std::uint32_t> byPosition(gates.size());
+    for (std::uint32_t gateNum = 0; gateNum < gates.size(); ++gateNum) {
+        position[gateNum]             = next[level[gateNum]]++;
+        byPosition[position[gateNum]] = gateNum;
+    }
+    std::vector<GateRecord> sortedGates;
+    std::vector<GateSource> sortedSources;
+    std::vector<Operand>    sortedOperands;
+    sortedGates.reserve(gates.size());
+    sortedSources.reserve(gates.size());
+    sortedOperands.reserve(operands.size());
+    for (auto gateNum: byPosition) {
+        auto record = gates[gateNum];
+        auto begin  = static_cast<std::uint32_t>(sortedOperands.size());
+        sortedOperands.insert(sortedOperands.end(), operands.begin() + record.operandBegin,
+                              operands.begin() + record.operandEnd);
+        record.operandBegin = begin;
+        record.operandEnd   = static_cast<std::uint32_t>(sortedOperands.size());
+        sortedGates.push_back(record);
+        sortedSources.push_back(gateSources[gateNum]);
+    }
+    gates       = std::move(sortedGates);
+    gateSources = std::move(sortedSources);
+    operands    = std::move(sortedOperands);
+    for (auto& gateNum: fanout) gateNum = position[gateNum];
+}
+
+// A Ref hit is only trusted if its anchor is on net in this block too, a block sharing the
+// netlist may have numbered its nets differently and is then looked up by position
+NetId Netlist::netId(const Block& block, Ref<ClosedNet> net) const {
+    if (block.nets.contains(net)) {
+        auto byRef = netIds.find(net);
+        if (byRef != netIds.end() && netRefAt(block, anchors[byRef->second]) == net)
+            return byRef->second;
+        auto byPos = netAnchors.find(lowestPortPos(block, block.nets[net]));
+        if (byPos != netAnchors.end()) return byPos->second;
+    }
+    throw std::logic_error("Net wasn't in the block when compiled");
+}
+
+std::optional<Ref<Gate>> Netlist::gateRef(const Block& block, std::size_t gateNum) const {
+    const auto& source = gateSources.at(gateNum);
+    if (source.kernelGate != GateSource::ownGate) return {};
+    auto obj = block.whatIsAtCoord(source.pos);
+    if (const auto* gate = std::get_if<Ref<Gate>>(&obj)) return *gate;
+    throw std::logic_error("Gate wasn't in the block when compiled");
+}
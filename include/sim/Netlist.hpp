@@ -0,0 +1,138 @@
+#pragma once
+
+#include <concepts>
+#include <functional>
+#include <limits>
+
+#include "block/Block.hpp"
+
+// dense index of a net in a Netlist, the simulators keep one value per net in an array
+using NetId = std::uint32_t;
+// a net read or written by a gate, the net id shifted up one with the low bit set if the port
+// is negated, so inversion is folded into the gate's bitwise op (see applyNegation)
+using Operand = std::uint32_t;
+
+inline constexpr Operand makeOperand(NetId net, bool negated) {
+    return (net << 1U) | static_cast<Operand>(negated);
+}
+inline constexpr NetId netOf(Operand operand) { return operand >> 1U; }
+inline constexpr bool  isNegated(Operand operand) { return (operand & 1U) != 0; }
+
+// value of a net as a word of independent bit lanes, see PatternWord
+template <typename Word>
+concept BitwiseWord = std::regular<Word> && requires(Word a, Word b) {
+    { a & b } -> std::convertible_to<Word>;
+    { a | b } -> std::convertible_to<Word>;
+    { a ^ b } -> std::convertible_to<Word>;
+    { ~a } -> std::convertible_to<Word>;
+};
+
+// value with every lane inverted if operand is negated, branchless for integer words
+template <BitwiseWord Word>
+inline Word applyNegation(const Word& value, Operand operand) {
+    if constexpr (std::unsigned_integral<Word>) {
+        return static_cast<Word>(value ^ static_cast<Word>(Word{0} - (operand & 1U)));
+    } else {
+        return isNegated(operand) ? static_cast<Word>(~value) : value;
+    }
+}
+
+// Not gates are compiled as single input Xors with their output negated
+struct GateRecord {
+    GateType      type;
+    std::uint8_t  delay; // ticks, only used by EventSimulator
+    std::uint32_t operandBegin; // into Netlist::operands
+    std::uint32_t operandEnd;
+    Operand       output;
+};
+
+// Where a gate record came from, by position so a netlist can be shared between equal blocks
+// Flattened gates name the instance they came from and their index in its block's netlist,
+// whose own gateSources continue the path down.
+struct GateSource {
+    static constexpr std::uint32_t ownGate = std::numeric_limits<std::uint32_t>::max();
+
+    Vec2i         pos;                  // of the gate, or of the instance it was flattened from
+    std::uint32_t kernelGate = ownGate; // into the instance's block's netlist
+};
+
+// Flat form of a Block's gates and nets for simulation
+// Every ClosedNet gets a dense NetId, gates are sorted by level so one pass in order evaluates
+// the whole block. A gate's level is one more than the highest level of the gates driving it.
+// Blocks with feedback loops can't be levelized, their gates are left in block order.
+// Block instances are flattened in by copying their block's compiled netlist (see KernelCache).
+// Nothing in it refers to the block by Ref, so it also describes any block with equal content.
+class Netlist {
+  public:
+    static constexpr NetId constantLow = 0; // read by unconnected gate inputs
+
+    // compiled netlist of an instance's block
+    using KernelLookup = std::function<const Netlist&(Ref<Block>)>;
+
+    // kernels is only needed if the block has instances
+    explicit Netlist(const Block& block, const KernelLookup& kernels = {});
+
+    std::size_t                netCount = 1;
+    std::vector<GateRecord>    gates;        // sorted by level
+    std::vector<Operand>       operands;     // each gate's inputs, contiguous
+    std::vector<std::uint32_t> levelBegins;  // gates in level l are [levelBegins[l], [l + 1])
+    std::vector<std::uint32_t> fanoutBegins; // gates reading net n are [fanoutBegins[n], [n + 1])
+    std::vector<std::uint32_t> fanout;       // of fanout
+    std::vector<GateSource>    gateSources;  // where each record was compiled from
+    std::vector<NetId>         freeNets;     // block's nets not driven by any gate, set these
+    std::vector<NetId>         portNets;     // net joined to each of the block's ports
+
+    // false if the block has a combinational loop, levelBegins is empty then
+    [[nodiscard]] bool        isLevelized() const { return !levelBegins.empty(); }
+    [[nodiscard]] std::size_t levelCount() const {
+        return isLevelized() ? levelBegins.size() - 1 : 0;
+    }
+    // block can be the compiled one or any with the same content
+    // throws if net wasn't in the block when compiled
+    [[nodiscard]] NetId netId(const Block& block, Ref<ClosedNet> net) const;
+    // nullopt if the gate was flattened in from an instance
+    [[nodiscard]] std::optional<Ref<Gate>> gateRef(const Block& block, std::size_t gateNum) const;
+
+  private:
+    // Refs are the compiled block's, a block sharing the netlist may number its nets differently
+    absl::flat_hash_map<Ref<ClosedNet>, NetId> netIds;
+    std::vector<Vec2i>                         anchors;    // by NetId, of the block's own nets
+    absl::flat_hash_map<Vec2i, NetId>          netAnchors; // lowest port position on each net
+
+    NetId netAt(const Block& block, const Vec2i& pos);
+    void  flatten(const Block& block, Ref<BlockInst> instRef, const Netlist& kernel,
+                  std::vector<bool>& driven);
+    void  levelize();
+};
+
+// Output of one gate given the current net values, one bit lane per independent input pattern
+template <BitwiseWord Word>
+inline Word evaluateGate(const Netlist& netlist, const GateRecord& gate, const Word* values) {
+    const auto* operands = netlist.operands.data();
+    auto        read     = [&](Operand operand) {
+        return applyNegation(values[netOf(operand)], operand);
+    };
+    Word acc = read(operands[gate.operandBegin]);
+    switch (gate.type) {
+    case GateType::And:
+        for (auto i = gate.operandBegin + 1; i < gate.operandEnd; ++i) acc &= read(operands[i]);
+        break;
+    case GateType::Or:
+        for (auto i = gate.operandBegin + 1; i < gate.operandEnd; ++i) acc |= read(operands[i]);
+        break;
+    case GateType::Xor:
+    case GateType::Not:
+        for (auto i = gate.operandBegin + 1; i < gate.operandEnd; ++i) acc ^= read(operands[i]);
+        break;
+    }
+    return applyNegation(acc, gate.output);
+}
+
+// Evaluates gates [begin, end) in order writing their outputs
+template <BitwiseWord Word>
+void evaluateGates(const Netlist& netlist, std::size_t begin, std::size_t end, Word* values) {
+    for (std::size_t gateNum = begin; gateNum < end; ++gateNum) {
+        const auto& gate           = netlist.gates[gateNum];
+        values[netOf(gate.output)] = evaluateGate(netlist, gate, values);
+    }
+}
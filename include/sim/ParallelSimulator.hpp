@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Netlist.hpp"
+#include "WorkStealingPool.hpp"
+#include "details/Profiler.hpp"
+
+// LevelSimulator with each level split across a WorkStealingPool
+// Gates in a level only read nets written by earlier levels and each writes its own net, so
+// finishing one level before starting the next is all the synchronisation needed and results
+// are identical to the single threaded run
+class ParallelSimulator {
+  private:
+    const Netlist&            netlist;
+    WorkStealingPool&         pool;
+    std::size_t               grain;
+    std::vector<std::uint8_t> values;
+
+  public:
+    // levels with no more than grain gates run on the calling thread alone
+    ParallelSimulator(const Netlist& netlist_, WorkStealingPool& pool_, std::size_t grain_ = 1024)
+        : netlist(netlist_), pool(pool_), grain(grain_), values(netlist_.netCount, 0) {
+        if (!netlist.isLevelized())
+            throw std::runtime_error("Block has a combinational loop so can't be levelized");
+    }
+
+    // only meaningful for the netlist's free nets, driven nets are overwritten by evaluate()
+    void set(NetId net, bool value) { values.at(net) = value ? 0xFF : 0x00; }
+    [[nodiscard]] bool get(NetId net) const { return (values.at(net) & 1U) != 0; }
+
+    // With TECHNO_LOGIC_PROFILING only call this from the GUI thread, the Profiler it reports to
+    // isn't thread safe. The pool's workers never touch it.
+    void evaluate() {
+        PROFILE_FUNCTION();
+        for (std::size_t level = 0; level < netlist.levelCount(); ++level) {
+            std::size_t levelBegin = netlist.levelBegins[level];
+            pool.parallelFor(netlist.levelBegins[level + 1] - levelBegin, grain,
+                             [&](std::size_t begin, std::size_t end) {
+                                 evaluateGates(netlist, levelBegin + begin, levelBegin + end,
+                                               values.data());
+                             });
+        }
+    }
+};
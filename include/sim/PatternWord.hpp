@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+// Words 64 bit lanes holding one bit of Words * 64 independent input patterns
+// bitwise ops use AVX-512 or AVX2 when the compiler targets them (see ENABLE_NATIVE_ARCH) and
+// plain 64 bit ops otherwise
+template <std::size_t Words>
+struct alignas(std::min<std::size_t>(std::bit_ceil(Words * 8), 64)) PatternWord {
+    static constexpr std::size_t patternCount = Words * 64;
+
+    std::array<std::uint64_t, Words> words{};
+
+    [[nodiscard]] bool get(std::size_t pattern) const {
+        return ((words[pattern / 64] >> (pattern % 64)) & 1U) != 0;
+    }
+    void set(std::size_t pattern, bool value) {
+        auto bit = std::uint64_t{1} << (pattern % 64);
+        words[pattern / 64] = value ? words[pattern / 64] | bit : words[pattern / 64] & ~bit;
+    }
+    // every pattern set to value
+    static PatternWord filled(bool value) {
+        PatternWord word;
+        word.words.fill(value ? ~std::uint64_t{0} : 0);
+        return word;
+    }
+
+    bool operator==(const PatternWord&) const = default;
+
+    friend PatternWord operator&(const PatternWord& a, const PatternWord& b) {
+        return zip<Op::And>(a, b);
+    }
+    friend PatternWord operator|(const PatternWord& a, const PatternWord& b) {
+        return zip<Op::Or>(a, b);
+    }
+    friend PatternWord operator^(const PatternWord& a, const PatternWord& b) {
+        return zip<Op::Xor>(a, b);
+    }
+    PatternWord  operator~() const { return *this ^ filled(true); }
+    PatternWord& operator&=(const PatternWord& other) { return *this = *this & other; }
+    PatternWord& operator|=(const PatternWord& other) { return *this = *this | other; }
+    PatternWord& operator^=(const PatternWord& other) { return *this = *this ^ other; }
+
+  private:
+    enum struct Op { And, Or, Xor };
+
+    template <Op op>
+    static PatternWord zip(const PatternWord& a, const PatternWord& b) {
+        PatternWord out;
+        std::size_t i = 0;
+#if defined(__AVX512F__)
+        for (; i + 8 <= Words; i += 8) {
+            auto x = _mm512_load_si512(a.words.data() + i);
+            auto y = _mm512_load_si512(b.words.data() + i);
+            if constexpr (op == Op::And) x = _mm512_and_si512(x, y);
+            if constexpr (op == Op::Or) x = _mm512_or_si512(x, y);
+            if constexpr (op == Op::Xor) x = _mm512_xor_si512(x, y);
+            _mm512_store_si512(out.words.data() + i, x);
+        }
+#endif
+#if defined(__AVX2__)
+        for (; i + 4 <= Words; i += 4) {
+            auto x = _mm256_load_si256(reinterpret_cast<const __m256i*>(a.words.data() + i));
+            auto y = _mm256_load_si256(reinterpret_cast<const __m256i*>(b.words.data() + i));
+            if constexpr (op == Op::And) x = _mm256_and_si256(x, y);
+            if constexpr (op == Op::Or) x = _mm256_or_si256(x, y);
+            if constexpr (op == Op::Xor) x = _mm256_xor_si256(x, y);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(out.words.data() + i), x);
+        }
+#endif
+        for (; i < Words; ++i) {
+            if constexpr (op == Op::And) out.words[i] = a.words[i] & b.words[i];
+            if constexpr (op == Op::Or) out.words[i] = a.words[i] | b.words[i];
+            if constexpr (op == Op::Xor) out.words[i] = a.words[i] ^ b.words[i];
+        }
+        return out;
+    }
+};
+
+// widest word the target has registers for, one 64 bit word without SIMD
+#if defined(__AVX512F__)
+using WidestPatternWord = PatternWord<8>;
+#elif defined(__AVX2__)
+using WidestPatternWord = PatternWord<4>;
+#else
+using WidestPatternWord = PatternWord<1>;
+#endif
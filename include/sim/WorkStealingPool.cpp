@@ -0,0 +1,80 @@
+#include "WorkStealingPool.hpp"
+
+WorkStealingPool::WorkStealingPool(std::size_t threadCount_) {
+    threadCount_ = std::max<std::size_t>(threadCount_, 1);
+    for (std::size_t i = 0; i < threadCount_; ++i) queues.push_back(std::make_unique<Queue>());
+    for (std::size_t i = 1; i < threadCount_; ++i) {
+        threads.emplace_back([this, i] { workerLoop(i); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& thread: threads) thread.join();
+}
+
+// own queue's front first, then the back of everyone else's
+std::optional<WorkStealingPool::Range> WorkStealingPool::take(std::size_t self) {
+    for (std::size_t i = 0; i < queues.size(); ++i) {
+        auto&           queue = *queues[(self + i) % queues.size()];
+        std::lock_guard lock(queue.mutex);
+        if (queue.ranges.empty()) continue;
+        Range range;
+        if (i == 0) {
+            range = queue.ranges.front();
+            queue.ranges.pop_front();
+        } else {
+            range = queue.ranges.back();
+            queue.ranges.pop_back();
+        }
+        return range;
+    }
+    return {};
+}
+
+void WorkStealingPool::work(std::size_t self) {
+    while (auto range = take(self)) {
+        job(range->begin, range->end);
+        if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard lock(mutex);
+            done.notify_all();
+        }
+    }
+}
+
+void WorkStealingPool::workerLoop(std::size_t self) {
+    std::uint64_t seenGeneration = 0;
+    while (true) {
+        {
+            std::unique_lock lock(mutex);
+            wake.wait(lock, [&] { return stopping || jobGeneration != seenGeneration; });
+            if (stopping) return;
+            seenGeneration = jobGeneration;
+        }
+        work(self);
+    }
+}
+
+// deals the ranges out round robin, then helps until they're all finished
+void WorkStealingPool::runJob(std::size_t count, std::size_t grain) {
+    grain           = std::max<std::size_t>(grain, 1);
+    auto rangeCount = (count + grain - 1) / grain;
+    remaining.store(rangeCount, std::memory_order_relaxed);
+    for (std::size_t i = 0; i < rangeCount; ++i) {
+        auto&           queue = *queues[i % queues.size()];
+        std::lock_guard lock(queue.mutex);
+        queue.ranges.push_back({i * grain, std::min(count, (i + 1) * grain)});
+    }
+    {
+        std::lock_guard lock(mutex);
+        ++jobGeneration;
+    }
+    wake.notify_all();
+    work(0);
+    std::unique_lock lock(mutex);
+    done.wait(lock, [&] { return remaining.load(std::memory_order_acquire) == 0; });
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for splitting loops into ranges
+// Each worker owns a deque of ranges, taking from its front and stealing from the back of the
+// others once it runs dry, so uneven ranges still keep every thread busy.
+class WorkStealingPool {
+  private:
+    struct Range {
+        std::size_t begin;
+        std::size_t end;
+    };
+    struct Queue {
+        std::mutex        mutex;
+        std::deque<Range> ranges;
+    };
+
+    std::vector<std::thread>            threads;
+    std::vector<std::unique_ptr<Queue>> queues; // [0] belongs to the thread calling parallelFor
+
+    std::function<void(std::size_t, std::size_t)> job;
+    std::atomic<std::size_t>                      remaining{0}; // ranges not yet finished
+    std::mutex                                    mutex;
+    std::condition_variable                       wake;
+    std::condition_variable                       done;
+    std::uint64_t                                 jobGeneration = 0;
+    bool                                          stopping      = false;
+
+    std::optional<Range> take(std::size_t self);
+    void                 work(std::size_t self);
+    void                 workerLoop(std::size_t self);
+    void                 runJob(std::size_t count, std::size_t grain);
+
+  public:
+    // threadCount includes the calling thread, 1 runs everything inline
+    explicit WorkStealingPool(std::size_t threadCount_ = std::thread::hardware_concurrency());
+    ~WorkStealingPool();
+    WorkStealingPool(const WorkStealingPool&)            = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    [[nodiscard]] std::size_t threadCount() const { return queues.size(); }
+
+    // calls func(begin, end) on ranges of at most grain covering [0, count), returns once all
+    // have finished. Not reentrant, func must not call parallelFor
+    template <typename F>
+    void parallelFor(std::size_t count, std::size_t grain, F&& func) {
+        if (threads.empty() || count <= grain) {
+            if (count != 0) func(std::size_t{0}, count);
+            return;
+        }
+        job = [&func](std::size_t begin, std::size_t end) { func(begin, end); };
+        runJob(count, grain);
+    }
+};
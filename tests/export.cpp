@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+
+#include "gtest/gtest.h"
+
+#include "block/BlockRenderer.hpp"
+
+// Image export needs a display for SFML's OpenGL context, ctest runs these under xvfb-run
+
+class ExportTest : public testing::Test {
+  protected:
+    std::filesystem::path dir =
+        std::filesystem::temp_directory_path() / "techno_logic_export_test";
+    Block block{"export", 20};
+
+    void SetUp() override {
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+        block.insertGate(Gate{GateType::And, {4, 4}, 2});
+        block.addConnection({0, 4}, {3, 4});
+        block.addConnection({0, 5}, {3, 5});
+        block.addConnection({5, 4}, {19, 4});
+        block.addConnection({10, 0}, {10, 19}); // crosses the output
+    }
+    void TearDown() override { std::filesystem::remove_all(dir); }
+};
+
+TEST_F(ExportTest, singleImageCoversBlock) {
+    ImageExportSettings settings{4.0f, 4096};
+    auto                written = exportBlockImage(block, dir / "block.png", settings);
+    ASSERT_EQ(written, std::vector{dir / "block.png"});
+    auto pix = static_cast<unsigned>(
+        std::ceil(BlockRenderer{block}.blockArea().size.x * settings.pixPerCoord));
+    EXPECT_EQ(sf::Image(written.front()).getSize(), sf::Vector2u(pix, pix));
+}
+
+TEST_F(ExportTest, tilesStitchIntoSingleImage) {
+    sf::Image whole(exportBlockImage(block, dir / "whole.png", {4.0f, 4096}).front());
+    auto      tiles = exportBlockImage(block, dir / "tiled.png", {4.0f, 32});
+
+    auto totalPix  = whole.getSize().x;
+    auto tileCount = (totalPix + 31) / 32;
+    ASSERT_GT(tileCount, 1);
+    ASSERT_EQ(tiles.size(), tileCount * tileCount);
+    for (unsigned row = 0; row < tileCount; ++row) {
+        for (unsigned col = 0; col < tileCount; ++col) {
+            auto path = dir / ("tiled_" + std::to_string(row) + "_" + std::to_string(col) + ".png");
+            ASSERT_EQ(tiles[row * tileCount + col], path);
+            sf::Image tile(path);
+            ASSERT_EQ(tile.getSize(), sf::Vector2u(std::min(32U, totalPix - col * 32),
+                                                   std::min(32U, totalPix - row * 32)));
+            // every pixel lands where it does in the single image, so there are no seams
+            unsigned mismatched = 0;
+            for (unsigned y = 0; y < tile.getSize().y; ++y) {
+                for (unsigned x = 0; x < tile.getSize().x; ++x) {
+                    if (tile.getPixel({x, y}) != whole.getPixel({col * 32 + x, row * 32 + y}))
+                        ++mismatched;
+                }
+            }
+            EXPECT_EQ(mismatched, 0) << "tile " << row << ", " << col;
+        }
+    }
+}
@@ -1,9 +1,16 @@
+#include <random>
 #include <ranges>
 
 #include "gtest/gtest.h"
 
 #include "block/Block.hpp"
+#include "details/Profiler.hpp"
 #include "details/StableVector.hpp"
+#include "sim/BitParallelSimulator.hpp"
+#include "sim/EventSimulator.hpp"
+#include "sim/KernelCache.hpp"
+#include "sim/LevelSimulator.hpp"
+#include "sim/ParallelSimulator.hpp"
 
 // Block
 class BlockTest : public testing::Test, public Block {
@@ -18,25 +25,25 @@ TEST_F(BlockTest, constructor) {
 }
 
 TEST_F(BlockTest, makeNewPortAtEmpty) {
-    sf::Vector2i pos        = {21, 21};
-    auto         emptyPoint = whatIsAtCoord(pos);
+    Vec2i pos        = {21, 21};
+    auto  emptyPoint = whatIsAtCoord(pos);
     EXPECT_EQ(ObjAtCoordType::Empty, typeOf(emptyPoint));
     auto newPort = makeNewPortRef(pos, Direction::up);
     EXPECT_EQ(PortObjType::Node, typeOf(newPort));
-    EXPECT_EQ(Direction::up, Direction(newPort.portNum));
+    EXPECT_EQ(Direction::up, Direction(newPort.portNum()));
     auto nodePoint = whatIsAtCoord(pos);
     EXPECT_EQ(ObjAtCoordType::Node, typeOf(nodePoint));
     auto nodeRef = std::get<Ref<Node>>(nodePoint);
-    EXPECT_EQ(nodeRef, std::get<Ref<Node>>(newPort.ref));
+    EXPECT_EQ(nodeRef, std::get<Ref<Node>>(newPort.ref()));
     EXPECT_EQ(nodes.size(), 1);
     EXPECT_TRUE(nodes.contains(nodeRef));
 }
 
 TEST_F(BlockTest, makeEmptyToEmptyCon) {
-    sf::Vector2i pos        = {21, 21};
-    auto         firstPort  = makeNewPortRef(pos, Direction::up);
-    sf::Vector2i secondPos  = {21, 13};
-    auto         secondPort = makeNewPortRef(secondPos, Direction::up); // wrong dir
+    Vec2i pos        = {21, 21};
+    auto  firstPort  = makeNewPortRef(pos, Direction::up);
+    Vec2i secondPos  = {21, 13};
+    auto  secondPort = makeNewPortRef(secondPos, Direction::up); // wrong dir
     EXPECT_ANY_THROW(insertCon({firstPort, secondPort}));
     secondPort = makeNewPortRef(secondPos, Direction::down); // right dir
     Connection con{firstPort, secondPort};
@@ -51,8 +58,8 @@ TEST_F(BlockTest, makeEmptyToEmptyCon) {
 }
 
 TEST_F(BlockTest, makeNewPortAtNode) {
-    sf::Vector2i startPos  = {0, 0};
-    auto         startPort = makeNewPortRef(startPos, Direction::down);
+    Vec2i startPos  = {0, 0};
+    auto  startPort = makeNewPortRef(startPos, Direction::down);
     EXPECT_EQ(startPort, makeNewPortRef(startPos, Direction::down)); // not made yet so ok
     auto       endPort = makeNewPortRef({0, 10}, Direction::up);
     Connection con{startPort, endPort};
@@ -64,7 +71,7 @@ TEST_F(BlockTest, makeNewPortAtNode) {
     insertCon(con2);
     EXPECT_EQ(nets.size(), 1);
     EXPECT_EQ(nodes.size(), 3);
-    EXPECT_EQ(getNodeConCount(std::get<Ref<Node>>(startPort.ref)), 2);
+    EXPECT_EQ(getNodeConCount(std::get<Ref<Node>>(startPort.ref())), 2);
     auto& net = *nets.begin();
     EXPECT_TRUE(net.obj.isConnected(endPort, endPort2));
 }
@@ -88,9 +95,9 @@ TEST_F(BlockTest, splitConnection1) {
     EXPECT_EQ(net.getSize(), 2);
     EXPECT_FALSE(net.contains(con1));
     EXPECT_TRUE(
-        net.contains({con1.portRef1, {splitConPort.ref, static_cast<size_t>(Direction::left)}}));
+        net.contains({con1.portRef1, {splitConPort.ref(), static_cast<size_t>(Direction::left)}}));
     EXPECT_TRUE(
-        net.contains({con1.portRef2, {splitConPort.ref, static_cast<size_t>(Direction::right)}}));
+        net.contains({con1.portRef2, {splitConPort.ref(), static_cast<size_t>(Direction::right)}}));
     EXPECT_TRUE(net.isConnected(con1.portRef1, con1.portRef2));
 }
 
@@ -188,6 +195,721 @@ TEST_F(BlockTest, eraseConSplitNet3) {
     // auto newNet = newNetOpt.value();
 }
 
+TEST_F(BlockTest, whatIsAtCoordMatchesScan) {
+    Connection con1 = addConnection({0, 2}, {8, 2});
+    Connection con2 = addConnection({4, 0}, {4, 8});
+    insertOverlap(con1, con2, {4, 2});
+    addConnection({0, 6}, {8, 6}); // crosses con2 without joining
+    addConnection({2, 2}, {2, 6}); // splits two cons
+    addConnection({6, 0}, {6, 8}); // crosses two more cons
+    eraseCon(addConnection({8, 2}, {8, 6}));
+    eraseCon(addConnection({0, 8}, {3, 8}));
+    for (int x = 0; x < 10; ++x) {
+        for (int y = 0; y < 10; ++y) {
+            Vec2i                    coord{x, y};
+            std::optional<Ref<Node>> nodeAt;
+            for (const auto& node: nodes) {
+                if (node.obj.pos == coord) nodeAt = node.ind;
+            }
+            std::size_t conCount = 0;
+            for (const auto& net: nets) {
+                for (const auto& con: net.obj) {
+                    if (collisionCheck(con, coord)) ++conCount;
+                }
+            }
+            auto obj = whatIsAtCoord(coord);
+            if (nodeAt) {
+                ASSERT_EQ(typeOf(obj), ObjAtCoordType::Node);
+                EXPECT_EQ(std::get<Ref<Node>>(obj), nodeAt.value());
+            } else if (conCount == 2) {
+                EXPECT_EQ(typeOf(obj), ObjAtCoordType::ConCross);
+            } else if (conCount == 1) {
+                EXPECT_EQ(typeOf(obj), ObjAtCoordType::Con);
+            } else {
+                EXPECT_EQ(typeOf(obj), ObjAtCoordType::Empty);
+            }
+        }
+    }
+}
+
+TEST_F(BlockTest, closNetRefTracksMergeAndSplit) {
+    Connection con1 = addConnection({0, 0}, {4, 0});
+    Connection con2 = addConnection({0, 4}, {4, 4});
+    Connection con3 = addConnection({2, 0}, {2, 4}); // merges nets of con1 and con2
+    addConnection({6, 0}, {6, 4});
+    EXPECT_EQ(nets.size(), 2);
+    eraseCon(con3); // splits them again
+    auto checkAllCons = [&] {
+        for (const auto& net: nets) {
+            for (const auto& con: net.obj) {
+                EXPECT_EQ(getClosNetRef(con.portRef1), net.ind);
+                EXPECT_EQ(getClosNetRef(con.portRef2), net.ind);
+                EXPECT_EQ(getClosNetRef(con), net.ind);
+            }
+        }
+    };
+    checkAllCons();
+    EXPECT_EQ(nets.size(), 3);
+    EXPECT_FALSE(getClosNetRef(con3).has_value());
+    EXPECT_NE(getClosNetRef(con1.portRef1), getClosNetRef(con2.portRef1));
+    addConnection({4, 0}, {6, 0});
+    addConnection({4, 4}, {6, 4});
+    EXPECT_EQ(nets.size(), 1);
+    checkAllCons();
+}
+
+TEST_F(BlockTest, eraseConMovesSmallerSide) {
+    // staircase so every corner node is kept
+    std::vector<Connection> cons;
+    Vec2i                   pos{0, 0};
+    for (int i = 0; i < 20; ++i) {
+        cons.push_back(addConnection(pos, pos + Vec2i{1, 0}));
+        pos += Vec2i{1, 0};
+        cons.push_back(addConnection(pos, pos + Vec2i{0, 1}));
+        pos += Vec2i{0, 1};
+    }
+    ASSERT_EQ(nets.size(), 1);
+    auto bigNet = nets.front().ind;
+    EXPECT_EQ(nets[bigNet].getSize(), 40);
+    EXPECT_FALSE(nets[bigNet].findSmallerSide(cons.front().portRef1, cons.back().portRef2));
+    eraseCon(cons[1]);
+    EXPECT_EQ(nets.size(), 2);
+    EXPECT_EQ(getClosNetRef(cons.back()), bigNet); // big side stays put
+    EXPECT_EQ(nets[bigNet].getSize(), 38);
+    EXPECT_EQ(nets[getClosNetRef(cons.front()).value()].getSize(), 1);
+    eraseCon(cons[37]);
+    EXPECT_EQ(getClosNetRef(cons[2]), bigNet);
+    EXPECT_EQ(nets[bigNet].getSize(), 35);
+}
+
+TEST_F(BlockTest, splitLongChain) {
+    // long staircase would overflow a recursive split
+    std::vector<Connection> cons;
+    Vec2i                   pos{0, 0};
+    for (int i = 0; i < 20000; ++i) {
+        cons.push_back(addConnection(pos, pos + Vec2i{1, 0}));
+        pos += Vec2i{1, 0};
+        cons.push_back(addConnection(pos, pos + Vec2i{0, 1}));
+        pos += Vec2i{0, 1};
+    }
+    ASSERT_EQ(nets.size(), 1);
+    auto  bigNet = nets.front().ind;
+    auto& net    = nets[bigNet];
+    EXPECT_FALSE(net.splitNet(cons.front().portRef1, cons.back().portRef2).has_value());
+    eraseCon(cons[cons.size() / 2]);
+    EXPECT_EQ(nets.size(), 2);
+    EXPECT_EQ(nets[getClosNetRef(cons.front()).value()].getSize(), 20000);
+    EXPECT_EQ(nets[getClosNetRef(cons.back()).value()].getSize(), 19999);
+    EXPECT_EQ(getClosNetRef(cons.front()), bigNet); // bigger half stays put
+}
+
+TEST_F(BlockTest, netAdjacencyVisitsEachConOnce) {
+    addConnection({0, 0}, {4, 0});
+    addConnection({4, 0}, {4, 4});
+    addConnection({4, 4}, {0, 4});
+    addConnection({2, 0}, {2, 4});
+    ASSERT_EQ(nets.size(), 1);
+    const auto&             net = nets.front().obj;
+    std::vector<Connection> seen;
+    for (const auto& con: net) {
+        EXPECT_EQ(std::count(seen.begin(), seen.end(), con), 0);
+        seen.push_back(con);
+        EXPECT_EQ(PortRef(con.portRef1.ref(), con.portRef1.portNum()), con.portRef1);
+        EXPECT_EQ(net.getCon(con.portRef1).portRef2, con.portRef2);
+        EXPECT_EQ(net.getCon(con.portRef2).portRef2, con.portRef1);
+        EXPECT_TRUE(net.contains(con.getSwapped()));
+    }
+    EXPECT_EQ(seen.size(), net.getSize());
+}
+
+TEST(BlockInternals, portRefPacksAndHashes) {
+    StableVector<Node> nodeVec;
+    StableVector<Gate> gateVec;
+    auto               node = nodeVec.insert(Node{{1, 2}});
+    auto               gate = gateVec.insert(Gate{});
+    PortRef            gatePort{gate, 3};
+    EXPECT_EQ(typeOf(gatePort), PortObjType::Gate);
+    EXPECT_EQ(std::get<Ref<Gate>>(gatePort.ref()), gate);
+    EXPECT_EQ(gatePort.portNum(), 3);
+    Connection con{PortRef{node, 3}, gatePort};
+    EXPECT_NE(con.portRef1, con.portRef2); // same index and port but different type
+    EXPECT_EQ(std::hash<Connection>{}(con), std::hash<Connection>{}(con.getSwapped()));
+    EXPECT_EQ(nodeVec[node].getPort(3).portDir, Direction::right);
+}
+
+TEST_F(BlockTest, rangeQueriesAlongSegment) {
+    Connection con1 = addConnection({0, 2}, {8, 2});
+    addConnection({3, 0}, {3, 2}); // node at (3, 2)
+    addConnection({6, 2}, {6, 5}); // node at (6, 2)
+    addConnection({10, 2}, {12, 2});
+    EXPECT_TRUE(nodesBetween({0, 2}, {3, 2}).empty()); // ends excluded
+    EXPECT_EQ(nodesBetween({0, 2}, {8, 2}).size(), 2);
+    EXPECT_EQ(nodesBetween({8, 2}, {0, 2}).size(), 2);
+    EXPECT_EQ(nodesBetween({1, 2}, {20, 2}).size(), 5);
+    EXPECT_EQ(nodesBetween({3, -5}, {3, 5}).size(), 2);
+    EXPECT_TRUE(nodesBetween({0, 3}, {8, 3}).empty());
+
+    EXPECT_EQ(consAlong({4, 2}, {5, 2}).size(), 1); // inside a single con
+    EXPECT_EQ(consAlong({2, 2}, {7, 2}).size(), 3);
+    EXPECT_EQ(consAlong({8, 2}, {10, 2}).size(), 0); // gap between cons
+    EXPECT_EQ(consAlong({9, 2}, {11, 2}).size(), 1);
+    EXPECT_EQ(consAlong({3, 1}, {3, 9}).size(), 1);
+    EXPECT_TRUE(consAlong({0, 5}, {8, 5}).empty());
+    EXPECT_FALSE(nets[getClosNetRef(con1.portRef1).value()].contains(con1)); // was split
+}
+
+TEST_F(BlockTest, batchMatchesUnbatched) {
+    auto build = [](Block& block) {
+        for (int row = 0; row < 6; ++row) { // rows built from unit segments
+            for (int x = 0; x < 10; ++x) block.addConnection({x, row * 3}, {x + 1, row * 3});
+        }
+        for (int row = 0; row < 5; ++row) { // columns only joining row ends
+            block.addConnection({0, row * 3}, {0, row * 3 + 3});
+            if (row % 2 == 1) block.addConnection({10, row * 3}, {10, row * 3 + 3});
+        }
+        auto con1 = block.addConnection({5, 20}, {5, 30});
+        auto con2 = block.addConnection({0, 25}, {10, 25});
+        block.insertOverlap(con1, con2, {5, 25});
+    };
+    build(*this);
+    Block batched{"batched", 50};
+    batched.beginBatch();
+    build(batched);
+    EXPECT_TRUE(batched.isBatching());
+    EXPECT_ANY_THROW(batched.eraseCon(*batched.nets.front().obj.begin()));
+    batched.commit();
+    EXPECT_FALSE(batched.isBatching());
+
+    EXPECT_EQ(batched.nets.size(), nets.size());
+    EXPECT_EQ(batched.nodes.size(), nodes.size());
+    auto conCount = [](const Block& block) {
+        std::size_t count = 0;
+        for (const auto& net: block.nets) count += net.obj.getSize();
+        return count;
+    };
+    EXPECT_EQ(conCount(batched), conCount(*this));
+    for (int x = 0; x < 12; ++x) {
+        for (int y = 0; y < 32; ++y) {
+            EXPECT_EQ(typeOf(batched.whatIsAtCoord({x, y})), typeOf(whatIsAtCoord({x, y})));
+        }
+    }
+    for (const auto& net: batched.nets) {
+        for (const auto& con: net.obj) EXPECT_EQ(batched.getClosNetRef(con.portRef1), net.ind);
+    }
+}
+
+TEST_F(BlockTest, commitLeavesTwoDriversUnjoinedAndClosesBatch) {
+    beginBatch();
+    auto not1 = insertGate(Gate{GateType::Not, {4, 0}, 1});
+    auto not2 = insertGate(Gate{GateType::Not, {4, 4}, 1});
+    auto con1 = addConnection({0, 8}, {2, 8}); // an unrelated join that is still committed
+    auto con2 = addConnection({2, 8}, {4, 8});
+    addConnection({5, 0}, {7, 0});
+    addConnection({5, 4}, {7, 4});
+    addConnection({7, 4}, {7, 0});
+    EXPECT_THROW(commit(), std::logic_error);
+    EXPECT_FALSE(isBatching());
+    EXPECT_EQ(typeOf(whatIsAtCoord({2, 8})), ObjAtCoordType::Con);
+    EXPECT_FALSE(contains(con1) || contains(con2));
+    auto out1 = getClosNetRef(PortRef(not1, 1)).value();
+    auto out2 = getClosNetRef(PortRef(not2, 1)).value();
+    EXPECT_NE(out1, out2);
+
+    // the failed batch's joins mustn't leak into the next one
+    beginBatch();
+    addConnection({0, 12}, {4, 12});
+    EXPECT_NO_THROW(commit());
+    EXPECT_EQ(getClosNetRef(PortRef(not1, 1)).value(), out1);
+    EXPECT_EQ(getClosNetRef(PortRef(not2, 1)).value(), out2);
+    EXPECT_EQ(nets[out1].getSize() + nets[out2].getSize(), 3);
+}
+
+TEST_F(BlockTest, generationsTrackEdits) {
+    auto start = getGeneration();
+    auto con1  = addConnection({0, 0}, {5, 0});
+    auto con2  = addConnection({0, 5}, {5, 5});
+    EXPECT_GT(getGeneration(), start);
+    auto net1    = getClosNetRef(con1).value();
+    auto net2    = getClosNetRef(con2).value();
+    auto net1Gen = getNetGeneration(net1);
+    auto net2Gen = getNetGeneration(net2);
+
+    auto before = getGeneration();
+    addConnection({5, 0}, {5, 3});
+    EXPECT_GT(getGeneration(), before);
+    EXPECT_GT(getNetGeneration(net1), net1Gen);
+    EXPECT_EQ(getNetGeneration(net2), net2Gen);
+
+    net1Gen = getNetGeneration(net1);
+    eraseCon(con1);
+    EXPECT_GT(getNetGeneration(net1), net1Gen);
+    EXPECT_EQ(getNetGeneration(net2), net2Gen);
+    eraseCon(con2);
+    EXPECT_ANY_THROW((void)getNetGeneration(net2)); // emptied net is removed
+    for (const auto& net: nets) EXPECT_NO_THROW((void)getNetGeneration(net.ind));
+}
+
+TEST_F(BlockTest, nodeEditsCoverChangedJunctions) {
+    auto has = [](const std::vector<Vec2i>& positions, const Vec2i& pos) {
+        return std::ranges::find(positions, pos) != positions.end();
+    };
+    auto start = getGeneration();
+    addConnection({0, 0}, {5, 0});
+    auto edits = getNodeEditsSince(start);
+    ASSERT_TRUE(edits);
+    EXPECT_TRUE(has(edits.value(), Vec2i{0, 0}));
+    EXPECT_TRUE(has(edits.value(), Vec2i{5, 0}));
+
+    auto before = getGeneration();
+    addConnection({5, 0}, {5, 3}); // (5, 0) becomes a corner
+    edits = getNodeEditsSince(before);
+    ASSERT_TRUE(edits);
+    EXPECT_TRUE(has(edits.value(), Vec2i{5, 0}));
+    EXPECT_FALSE(has(edits.value(), Vec2i{0, 0}));
+    EXPECT_TRUE(getNodeEditsSince(getGeneration())->empty());
+
+    for (int y = 10; y < 3000; y += 2) addConnection({0, y}, {1, y});
+    EXPECT_FALSE(getNodeEditsSince(start)); // log has moved on
+    EXPECT_TRUE(getNodeEditsSince(getGeneration()));
+}
+
+TEST_F(BlockTest, gatePortsDriveAndReadNets) {
+    auto driver = insertGate(Gate{GateType::And, {4, 0}, 2});
+    auto reader = insertGate(Gate{GateType::Or, {8, 0}, 2});
+    EXPECT_EQ(ObjAtCoordType::Gate, typeOf(whatIsAtCoord({4, 0})));
+    EXPECT_EQ(PortRef(reader, 1), std::get<PortRef>(whatIsAtCoord({7, 1})));
+    EXPECT_ANY_THROW(insertGate(Gate{GateType::Not, {6, 1}, 1})); // port on top of reader's
+    auto con = addConnection({5, 0}, {7, 0});
+    auto net = getClosNetRef(con).value();
+    EXPECT_EQ(nets[net].getInput(), PortRef(driver, gates[driver].outputPortNum()));
+    EXPECT_EQ(nets[net].getOutputs(), std::vector<PortRef>{PortRef(reader, 0)});
+    auto other     = insertGate(Gate{GateType::Not, {6, 3}, 1});
+    auto nodeCount = nodes.size();
+    EXPECT_ANY_THROW(addConnection({7, 3}, {7, 2})); // must leave in the direction it faces
+    EXPECT_ANY_THROW(addConnection({7, 3}, {6, 3})); // can't connect into the gate body
+    EXPECT_ANY_THROW(addConnection({7, 2}, {7, 3})); // or arrive against it
+    EXPECT_EQ(nodes.size(), nodeCount);              // failed connections leave nothing behind
+    EXPECT_EQ(ObjAtCoordType::Empty, typeOf(whatIsAtCoord({7, 2})));
+
+    eraseGate(driver);
+    EXPECT_FALSE(nets.contains(net));
+    EXPECT_EQ(ObjAtCoordType::Empty, typeOf(whatIsAtCoord({4, 0})));
+    EXPECT_EQ(ObjAtCoordType::Port, typeOf(whatIsAtCoord({7, 0})));
+    EXPECT_TRUE(gates.contains(other));
+}
+
+// Simulation
+// connects each point to the next
+static void wire(Block& block, std::initializer_list<Vec2i> points) {
+    for (const auto* it = points.begin(); it + 1 != points.end(); ++it) {
+        block.addConnection(*it, *(it + 1));
+    }
+}
+
+TEST_F(BlockTest, levelSimulatorMatchesTruthTable) {
+    Gate andGate{GateType::And, {4, 0}, 2};
+    andGate.ports[1].negated = true;
+    Gate xnorGate{GateType::Xor, {8, 0}, 2};
+    xnorGate.ports.back().negated = true;
+    insertGate(andGate);
+    auto xnor   = insertGate(xnorGate);
+    auto notRef = insertGate(Gate{GateType::Not, {12, 0}, 1});
+    wire(*this, {{0, 0}, {3, 0}});                 // a
+    wire(*this, {{0, 1}, {3, 1}});                 // b, negated
+    wire(*this, {{0, 3}, {6, 3}, {6, 1}, {7, 1}}); // c
+    wire(*this, {{5, 0}, {7, 0}});
+    wire(*this, {{9, 0}, {11, 0}});
+    wire(*this, {{13, 0}, {15, 0}});
+
+    Netlist netlist{*this};
+    EXPECT_EQ(netlist.levelCount(), 3);
+    EXPECT_EQ(netlist.gateRef(*this, netlist.gates.size() - 1), notRef);
+    EXPECT_EQ(netlist.freeNets.size(), 3);
+    auto net = [&](const Vec2i& pos) {
+        return netlist.netId(*this, getClosNetRef(std::get<Ref<Node>>(whatIsAtCoord(pos))).value());
+    };
+    LevelSimulator sim{netlist};
+    auto           xnorOut = netlist.netId(*this, getClosNetRef(PortRef(xnor, 2)).value());
+    for (int bits = 0; bits < 8; ++bits) {
+        bool a = (bits & 1) != 0, b = (bits & 2) != 0, c = (bits & 4) != 0;
+        sim.set(net({0, 0}), a);
+        sim.set(net({0, 1}), b);
+        sim.set(net({0, 3}), c);
+        sim.evaluate();
+        EXPECT_EQ(sim.get(xnorOut), !((a && !b) != c)) << bits;
+        EXPECT_EQ(sim.get(net({15, 0})), (a && !b) != c) << bits;
+    }
+}
+
+TEST_F(BlockTest, bitParallelMatchesLevelSimulator) {
+    Gate orGate{GateType::Or, {4, 0}, 3};
+    orGate.ports[1].negated = true;
+    Gate xnorGate{GateType::Xor, {12, 0}, 2};
+    xnorGate.ports.back().negated = true;
+    insertGate(orGate);
+    insertGate(Gate{GateType::Not, {8, 0}, 1});
+    insertGate(xnorGate);
+    wire(*this, {{0, 0}, {3, 0}});
+    wire(*this, {{0, 1}, {3, 1}});
+    wire(*this, {{0, 2}, {3, 2}});
+    wire(*this, {{1, 2}, {1, 4}, {10, 4}, {10, 1}, {11, 1}}); // branches off the third input
+    wire(*this, {{5, 0}, {7, 0}});
+    wire(*this, {{9, 0}, {11, 0}});
+    wire(*this, {{13, 0}, {15, 0}});
+
+    Netlist netlist{*this};
+    ASSERT_EQ(netlist.freeNets.size(), 3);
+    LevelSimulator scalar{netlist};
+    std::mt19937   gen(42); // NOLINT fixed seed for reproducibility
+    auto           check = [&]<typename Word>(BitParallelSimulator<Word> sim) {
+        for (std::size_t pattern = 0; pattern < sim.patternCount; ++pattern) {
+            for (auto net: netlist.freeNets) sim.set(net, pattern, gen() % 2 == 0);
+        }
+        sim.evaluate();
+        for (std::size_t pattern = 0; pattern < sim.patternCount; ++pattern) {
+            for (auto net: netlist.freeNets) scalar.set(net, sim.get(net, pattern));
+            scalar.evaluate();
+            for (NetId net = 0; net < netlist.netCount; ++net) {
+                EXPECT_EQ(sim.get(net, pattern), scalar.get(net)) << net << " " << pattern;
+            }
+        }
+    };
+    check(BitParallelSimulator<PatternWord<1>>{netlist});
+    check(BitParallelSimulator<PatternWord<3>>{netlist}); // tail past the SIMD width
+    check(BitParallelSimulator<PatternWord<4>>{netlist});
+    check(BitParallelSimulator<PatternWord<8>>{netlist});
+}
+
+TEST_F(BlockTest, ringOscillatorTogglesWithGateDelays) {
+    std::array<Ref<Gate>, 3> ring{insertGate(Gate{GateType::Not, {4, 0}, 1}),
+                                  insertGate(Gate{GateType::Not, {8, 0}, 1}),
+                                  insertGate(Gate{GateType::Not, {12, 0}, 1})};
+    wire(*this, {{5, 0}, {7, 0}});
+    wire(*this, {{9, 0}, {11, 0}});
+    wire(*this, {{13, 0}, {14, 0}, {14, -2}, {2, -2}, {2, 0}, {3, 0}});
+
+    Netlist netlist{*this};
+    EXPECT_FALSE(netlist.isLevelized());
+    EXPECT_THROW(LevelSimulator{netlist}, std::runtime_error);
+    auto           out = netlist.netId(*this, getClosNetRef(PortRef(ring[2], 1)).value());
+    EventSimulator sim{netlist};
+    EXPECT_FALSE(sim.settle(100));
+    // three unit delays each way so the output flips every 3 ticks
+    std::vector<bool> seen;
+    for (int i = 0; i < 12; ++i) {
+        sim.step();
+        seen.push_back(sim.get(out));
+    }
+    for (std::size_t i = 3; i < seen.size(); ++i) EXPECT_NE(seen[i], seen[i - 3]) << i;
+    EXPECT_EQ(sim.now(), 112);
+}
+
+TEST_F(BlockTest, norLatchHoldsState) {
+    // q = !(r | qBar), qBar = !(s | q)
+    Gate qGate{GateType::Or, {4, 0}, 2};
+    qGate.ports.back().negated = true;
+    Gate qBarGate{GateType::Or, {4, 6}, 2};
+    qBarGate.ports.back().negated = true;
+    auto q    = insertGate(qGate);
+    auto qBar = insertGate(qBarGate);
+    wire(*this, {{0, 1}, {3, 1}});                                  // r
+    wire(*this, {{0, 7}, {3, 7}});                                  // s
+    wire(*this, {{5, 0}, {7, 0}, {7, 4}, {2, 4}, {2, 6}, {3, 6}});   // q
+    wire(*this, {{5, 6}, {8, 6}, {8, -2}, {2, -2}, {2, 0}, {3, 0}}); // qBar
+
+    Netlist        netlist{*this};
+    auto           net   = [&](const PortRef& port) {
+        return netlist.netId(*this, getClosNetRef(port).value());
+    };
+    auto           r     = net(PortRef(q, 1));
+    auto           s     = net(PortRef(qBar, 1));
+    auto           qNet  = net(PortRef(q, 2));
+    EventSimulator sim{netlist};
+    auto           apply = [&](bool sValue, bool rValue) {
+        sim.set(s, sValue);
+        sim.set(r, rValue);
+        EXPECT_TRUE(sim.settle(100));
+        EXPECT_NE(sim.get(qNet), sim.get(net(PortRef(qBar, 2))));
+        return sim.get(qNet);
+    };
+    EXPECT_TRUE(apply(true, false));
+    EXPECT_TRUE(apply(false, false));
+    EXPECT_FALSE(apply(false, true));
+    EXPECT_FALSE(apply(false, false));
+    EXPECT_TRUE(apply(true, false));
+
+    // settled so idle ticks are skipped and nothing changes
+    sim.run(1'000'000);
+    EXPECT_TRUE(sim.changedNets().empty());
+    EXPECT_TRUE(sim.get(qNet));
+}
+
+TEST(WorkStealingPool, parallelForCoversEachIndexOnce) {
+    WorkStealingPool              pool{4};
+    std::vector<std::atomic<int>> hits(1000);
+    for (std::size_t grain: std::array<std::size_t, 4>{1, 7, 64, 1000}) {
+        for (auto& hit: hits) hit = 0;
+        pool.parallelFor(hits.size(), grain, [&](std::size_t begin, std::size_t end) {
+            EXPECT_LE(end - begin, grain);
+            for (auto i = begin; i < end; ++i) ++hits[i];
+        });
+        for (const auto& hit: hits) EXPECT_EQ(hit, 1);
+    }
+}
+
+TEST_F(BlockTest, parallelMatchesLevelSimulator) {
+    // grid of 2 input gates each reading the gate to its left and the one down and to the left
+    constexpr int        side = 12;
+    constexpr std::array types{GateType::And, GateType::Or, GateType::Xor};
+    beginBatch();
+    for (int col = 0; col < side; ++col) {
+        for (int row = 0; row < side; ++row) {
+            auto type = types[static_cast<std::size_t>(row * 7 + col) % types.size()];
+            Gate gate{type, {4 * col + 2, 3 * row}, 2};
+            gate.ports[0].negated = (row + col) % 5 == 0;
+            insertGate(gate);
+        }
+    }
+    for (int col = 0; col < side; ++col) {
+        int x = 4 * col;
+        for (int row = 0; row < side; ++row) {
+            addConnection({col == 0 ? x - 2 : x - 1, 3 * row}, {x + 1, 3 * row});
+        }
+        for (int row = 0; row + 1 < side; ++row) {
+            addConnection({x, 3 * row + 3}, {x, 3 * row + 1});
+            addConnection({x, 3 * row + 1}, {x + 1, 3 * row + 1});
+        }
+    }
+    commit();
+
+    Netlist netlist{*this};
+    ASSERT_EQ(netlist.levelCount(), side);
+    WorkStealingPool  pool{4};
+    LevelSimulator    scalar{netlist};
+    ParallelSimulator parallel{netlist, pool, 2};
+    std::mt19937      gen(42); // NOLINT fixed seed for reproducibility
+    for (int run = 0; run < 20; ++run) {
+        for (auto net: netlist.freeNets) {
+            bool value = gen() % 2 == 0;
+            scalar.set(net, value);
+            parallel.set(net, value);
+        }
+        scalar.evaluate();
+        parallel.evaluate();
+        for (NetId net = 0; net < netlist.netCount; ++net) {
+            ASSERT_EQ(scalar.get(net), parallel.get(net)) << net << " " << run;
+        }
+    }
+}
+
+// 2 input gate of the given type between ports a and b and output y, wired in either order
+static void makeGate2(Block& block, GateType type, bool reversed) {
+    block.ports = {{"a", PortType::input, {0, 0}},
+                   {"b", PortType::input, {0, 1}},
+                   {"y", PortType::output, {7, 0}}};
+    block.insertGate(Gate{type, {4, 0}, 2});
+    std::vector<std::pair<Vec2i, Vec2i>> wires{
+        {{0, 0}, {3, 0}}, {{0, 1}, {3, 1}}, {{5, 0}, {7, 0}}};
+    if (reversed) std::ranges::reverse(wires);
+    for (auto [start, end]: wires) block.addConnection(start, end);
+}
+
+TEST(KernelCache, flattensInstancesAndRecompilesOnlyEdits) {
+    StableVector<Block> library;
+    auto                gate2  = library.insert(Block{"gate2", 50});
+    auto                copy   = library.insert(Block{"copy", 50});
+    auto                parity = library.insert(Block{"parity", 50});
+    auto                spare  = library.insert(Block{"spare", 50});
+    makeGate2(library[gate2], GateType::Xor, false);
+    makeGate2(library[copy], GateType::Xor, true);
+    makeGate2(library[spare], GateType::Or, false);
+    auto& top = library[parity];
+    top.ports = {{"a", PortType::input, {0, 0}},
+                 {"b", PortType::input, {0, 1}},
+                 {"c", PortType::input, {0, 3}},
+                 {"y", PortType::output, {13, 0}}};
+    top.insertBlockInst(BlockInst{gate2, library[gate2].ports, {4, 0}});
+    top.insertBlockInst(BlockInst{gate2, library[gate2].ports, {10, 0}});
+    wire(top, {{0, 0}, {3, 0}});
+    wire(top, {{0, 1}, {3, 1}});
+    wire(top, {{5, 0}, {9, 0}});
+    wire(top, {{0, 3}, {8, 3}, {8, 1}, {9, 1}});
+    wire(top, {{11, 0}, {13, 0}});
+    EXPECT_THROW(Netlist{top}, std::logic_error);
+
+    KernelCache cache{library};
+    EXPECT_EQ(&cache.get(gate2), &cache.get(copy));
+    EXPECT_NE(&cache.get(gate2), &cache.get(spare));
+    EXPECT_EQ(cache.getCompileCount(), 2);
+    // the copy's nets were made in the other order, so it finds them by position, not Ref
+    const auto& shared  = cache.get(copy);
+    const auto& twin    = library[copy];
+    auto        nodeNet = [&](const Vec2i& pos) {
+        auto node = std::get<Ref<Node>>(twin.whatIsAtCoord(pos));
+        return shared.netId(twin, twin.getClosNetRef(node).value());
+    };
+    EXPECT_EQ(nodeNet({0, 0}), shared.portNets[0]);
+    EXPECT_EQ(nodeNet({7, 0}), shared.portNets[2]);
+    EXPECT_EQ(shared.gateRef(twin, 0), std::get<Ref<Gate>>(twin.whatIsAtCoord({4, 0})));
+
+    auto check = [&](const Netlist& netlist, auto&& expected) {
+        ASSERT_EQ(netlist.portNets.size(), 4);
+        EXPECT_EQ(netlist.gates.size(), 2);
+        EXPECT_EQ(netlist.levelCount(), 2);
+        EXPECT_EQ(netlist.freeNets,
+                  std::vector(netlist.portNets.begin(), netlist.portNets.end() - 1));
+        LevelSimulator sim{netlist};
+        for (int bits = 0; bits < 8; ++bits) {
+            bool a = (bits & 1) != 0, b = (bits & 2) != 0, c = (bits & 4) != 0;
+            sim.set(netlist.portNets[0], a);
+            sim.set(netlist.portNets[1], b);
+            sim.set(netlist.portNets[2], c);
+            sim.evaluate();
+            EXPECT_EQ(sim.get(netlist.portNets[3]), expected(a, b, c)) << bits;
+        }
+    };
+    check(cache.get(parity), [](bool a, bool b, bool c) { return (a != b) != c; });
+    EXPECT_EQ(cache.getCompileCount(), 3); // both instances reuse gate2's kernel
+    for (std::size_t gateNum = 0; gateNum < 2; ++gateNum) { // flattened gates name their instance
+        const auto& source = cache.get(parity).gateSources[gateNum];
+        EXPECT_EQ(cache.get(parity).gateRef(top, gateNum), std::nullopt);
+        EXPECT_EQ(source.kernelGate, 0);
+        EXPECT_EQ(source.pos, Vec2i(4 + 6 * static_cast<int>(gateNum), 0));
+    }
+
+    // redrawing the same wire changes the generation but not the content
+    library[gate2].eraseCon(std::get<Connection>(library[gate2].whatIsAtCoord({6, 0})));
+    wire(library[gate2], {{5, 0}, {7, 0}});
+    cache.get(parity);
+    EXPECT_EQ(cache.getCompileCount(), 3);
+
+    // a real edit recompiles the edited block and its users, nothing else
+    auto& leaf = library[gate2];
+    leaf.eraseGate(std::get<Ref<Gate>>(leaf.whatIsAtCoord({4, 0})));
+    leaf.insertGate(Gate{GateType::And, {4, 0}, 2});
+    wire(leaf, {{0, 0}, {3, 0}});
+    wire(leaf, {{0, 1}, {3, 1}});
+    wire(leaf, {{5, 0}, {7, 0}});
+    check(cache.get(parity), [](bool a, bool b, bool c) { return a && b && c; });
+    cache.get(copy);
+    cache.get(spare);
+    EXPECT_EQ(cache.getCompileCount(), 5);
+    EXPECT_EQ(cache.size(), 5);
+    cache.pruneUnused(); // only the old parity kernel is unused, copy still has the xor one
+    EXPECT_EQ(cache.size(), 4);
+
+    library[spare].insertBlockInst(BlockInst{spare, library[spare].ports, {20, 20}});
+    EXPECT_THROW(cache.get(spare), std::logic_error);
+}
+
+TEST(KernelCache, undrivenNetsInsideInstancesAreFree) {
+    StableVector<Block> library;
+    auto                inner = library.insert(Block{"inner", 50});
+    auto                outer = library.insert(Block{"outer", 50});
+    makeGate2(library[inner], GateType::And, false);
+    library[inner].ports.erase(library[inner].ports.begin() + 1); // b is only wired inside
+    auto& top = library[outer];
+    top.ports = {{"a", PortType::input, {0, 0}}, {"y", PortType::output, {7, 0}}};
+    top.insertBlockInst(BlockInst{inner, library[inner].ports, {4, 0}});
+    wire(top, {{0, 0}, {3, 0}});
+    wire(top, {{5, 0}, {7, 0}});
+
+    KernelCache cache{library};
+    const auto& netlist = cache.get(outer);
+    ASSERT_EQ(netlist.freeNets.size(), 2);
+    EXPECT_EQ(netlist.freeNets[0], netlist.portNets[0]);
+    LevelSimulator sim{netlist};
+    sim.set(netlist.portNets[0], true);
+    sim.set(netlist.freeNets[1], true);
+    sim.evaluate();
+    EXPECT_TRUE(sim.get(netlist.portNets[1]));
+}
+
+TEST(Helpers, lineIntersectionsMatchPairwise) {
+    using Line = std::pair<Vec2i, Vec2i>;
+    std::mt19937                       gen(42); // NOLINT fixed seed for reproducibility
+    std::uniform_int_distribution<int> coordDist(0, 30);
+    std::uniform_int_distribution<int> lenDist(1, 15);
+
+    auto randomLines = [&](std::size_t count) {
+        std::vector<Line> lines;
+        for (std::size_t i = 0; i < count; ++i) {
+            Vec2i start{coordDist(gen), coordDist(gen)};
+            Vec2i diff{0, lenDist(gen)};
+            if (i % 2 == 0) std::swap(diff.x, diff.y);
+            lines.emplace_back(start, start + diff);
+        }
+        return lines;
+    };
+    auto lines1 = randomLines(60);
+    auto lines2 = randomLines(40);
+    lines2.emplace_back(Vec2i{5, 0}, Vec2i{5, 10}); // touching ends don't count
+    lines1.emplace_back(Vec2i{0, 10}, Vec2i{5, 10});
+
+    std::vector<Vec2i> expected;
+    for (const auto& line1: lines1) {
+        for (const auto& line2: lines2) {
+            if (auto pos = getLineIntersection(line1, line2)) expected.push_back(pos.value());
+        }
+    }
+    auto actual   = getLineIntersections(lines1, lines2);
+    auto vecOrder = [](const auto& a, const auto& b) {
+        return std::tie(a.x, a.y) < std::tie(b.x, b.y);
+    };
+    std::sort(expected.begin(), expected.end(), vecOrder);
+    std::sort(actual.begin(), actual.end(), vecOrder);
+    EXPECT_FALSE(expected.empty());
+    EXPECT_EQ(actual, expected);
+}
+
+TEST(Helpers, ringBufferKeepsNewestAndRanks) {
+    RingBuffer<int, 4> buf;
+    EXPECT_TRUE(buf.empty());
+    for (int i = 1; i <= 6; ++i) buf.push(i);
+    ASSERT_EQ(buf.size(), 4);
+    EXPECT_EQ(buf[0], 3);
+    EXPECT_EQ(buf.back(), 6);
+    EXPECT_EQ(buf.percentile(0.0), 3);
+    EXPECT_EQ(buf.percentile(1.0), 6);
+    std::vector<int> flat;
+    buf.linearise(flat);
+    EXPECT_EQ(flat, (std::vector<int>{3, 4, 5, 6}));
+}
+
+TEST(Helpers, profilerCountsCallsPerFrame) {
+    auto& profiler   = Profiler::get();
+    profiler.enabled = true;
+    auto id          = profiler.registerCounter("test lookup");
+    EXPECT_EQ(profiler.registerCounter("test lookup"), id);
+    for (int i = 0; i < 3; ++i) profiler.count(id);
+    profiler.endFrame();
+    profiler.count(id);
+    profiler.skipFrame(); // dropped, not carried into the next frame
+    profiler.endFrame();
+    profiler.enabled   = false;
+    const auto& counts = profiler.getCounters()[id].counts;
+    ASSERT_EQ(counts.size(), 2);
+    EXPECT_EQ(counts[0], 3);
+    EXPECT_EQ(counts[1], 0);
+}
+
+TEST(Helpers, vec2Arithmetic) {
+    Vec2i a{3, -4};
+    Vec2i b{1, 2};
+    EXPECT_EQ(a + b, (Vec2i{4, -2}));
+    EXPECT_EQ(a - b, (Vec2i{2, -6}));
+    EXPECT_EQ(-a, (Vec2i{-3, 4}));
+    EXPECT_EQ(a * 2, 2 * a);
+    EXPECT_EQ(a / 2, (Vec2i{1, -2}));
+    a += b;
+    EXPECT_EQ(a, (Vec2i{4, -2}));
+    EXPECT_EQ(Vec2f(b), (Vec2f{1.0f, 2.0f}));
+    EXPECT_EQ(normalise(Vec2i{0, -7}), (Vec2i{0, -1}));
+    EXPECT_EQ(mag(Vec2f{3.0f, 4.0f}), 5.0f);
+    absl::flat_hash_set<Vec2i> set{{1, 2}, {2, 1}, {1, 2}};
+    EXPECT_EQ(set.size(), 2);
+}
+
 // StableVector
 template <typename T, typename Q>
 void equalityCheck(T subj, const std::vector<Q>& vec) { // subj is taken by value